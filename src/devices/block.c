@@ -3,7 +3,8 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /*! A block device. */
 struct block {
@@ -20,8 +21,14 @@ struct block {
     unsigned long long write_cnt;       /*!< Number of sectors written. */
 };
 
-/*! List of all block devices. */
+/*! List of all block devices.  Devices are only ever added, at boot,
+    so lookups take all_blocks_lock for reading. */
 static struct list all_blocks = LIST_INITIALIZER(all_blocks);
+static struct rwlock all_blocks_lock = RWLOCK_INITIALIZER(all_blocks_lock);
+
+/*! Cache that block device descriptors are allocated from, created by
+    the first block_register(). */
+static struct kmem_cache *block_cache;
 
 /*! The block block assigned to each Pintos role. */
 static struct block *block_by_role[BLOCK_ROLE_CNT];
@@ -59,28 +66,41 @@ void block_set_role(enum block_type role, struct block *block) {
 /*! Returns the first block device in kernel probe order, or a
     null pointer if no block devices are registered. */
 struct block * block_first(void) {
-    return list_elem_to_block(list_begin(&all_blocks));
+    struct block *block;
+
+    rwlock_read_acquire(&all_blocks_lock);
+    block = list_elem_to_block(list_begin(&all_blocks));
+    rwlock_read_release(&all_blocks_lock);
+    return block;
 }
 
 /*! Returns the block device following BLOCK in kernel probe
     order, or a null pointer if BLOCK is the last block device. */
 struct block * block_next(struct block *block) {
-    return list_elem_to_block(list_next(&block->list_elem));
+    rwlock_read_acquire(&all_blocks_lock);
+    block = list_elem_to_block(list_next(&block->list_elem));
+    rwlock_read_release(&all_blocks_lock);
+    return block;
 }
 
 /*! Returns the block device with the given NAME, or a null
     pointer if no block device has that name. */
 struct block * block_get_by_name(const char *name) {
     struct list_elem *e;
+    struct block *found = NULL;
 
+    rwlock_read_acquire(&all_blocks_lock);
     for (e = list_begin(&all_blocks); e != list_end(&all_blocks);
          e = list_next(e)) {
         struct block *block = list_entry(e, struct block, list_elem);
-        if (!strcmp(name, block->name))
-            return block;
+        if (!strcmp(name, block->name)) {
+            found = block;
+            break;
+        }
     }
+    rwlock_read_release(&all_blocks_lock);
 
-    return NULL;
+    return found;
 }
 
 /*! Verifies that SECTOR is a valid offset within BLOCK.  Panics if not. */
@@ -152,11 +172,15 @@ void block_print_stats(void) {
 struct block * block_register(const char *name, enum block_type type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *ops, void *aux) {
-    struct block *block = malloc(sizeof *block);
+    struct block *block;
+
+    rwlock_write_acquire(&all_blocks_lock);
+    if (block_cache == NULL)
+        block_cache = kmem_cache_create("block", sizeof *block, NULL);
+    block = block_cache != NULL ? kmem_cache_alloc(block_cache) : NULL;
     if (block == NULL)
         PANIC("Failed to allocate memory for block device descriptor");
 
-    list_push_back(&all_blocks, &block->list_elem);
     strlcpy(block->name, name, sizeof block->name);
     block->type = type;
     block->size = size;
@@ -164,6 +188,8 @@ struct block * block_register(const char *name, enum block_type type,
     block->aux = aux;
     block->read_cnt = 0;
     block->write_cnt = 0;
+    list_push_back(&all_blocks, &block->list_elem);
+    rwlock_write_release(&all_blocks_lock);
 
     printf("%s: %'"PRDSNu" sectors (", block->name, block->size);
     print_human_readable_size((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -73,6 +73,7 @@ struct channel {
     uint8_t irq;                /*!< Interrupt in use. */
 
     struct lock lock;           /*!< Must acquire to access the controller. */
+    struct lock_profile lock_profile;   /*!< Contention on LOCK. */
     bool expecting_interrupt;   /*!< True if an interrupt is expected, false if
                                      any interrupt would be spurious. */
     struct semaphore completion_wait;   /*!< Up'd by interrupt handler. */
@@ -125,6 +126,7 @@ void ide_init (void) {
             NOT_REACHED();
         }
         lock_init(&c->lock);
+        lock_profile(&c->lock, &c->lock_profile, c->name);
         c->expecting_interrupt = false;
         sema_init(&c->completion_wait, 0);
  
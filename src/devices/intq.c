@@ -3,15 +3,15 @@
 #include "threads/thread.h"
 
 static int next (int pos);
-static void wait (struct intq *q, struct thread **waiter);
-static void signal (struct intq *q, struct thread **waiter);
+static void wait (struct intq *q, struct wait_queue *waiters);
+static void signal (struct intq *q, struct wait_queue *waiters);
 
 /* Initializes interrupt queue Q. */
 void
 intq_init (struct intq *q) 
 {
-  lock_init (&q->lock);
-  q->not_full = q->not_empty = NULL;
+  wait_queue_init (&q->not_full);
+  wait_queue_init (&q->not_empty);
   q->head = q->tail = 0;
 }
 
@@ -43,9 +43,7 @@ intq_getc (struct intq *q)
   while (intq_empty (q)) 
     {
       ASSERT (!intr_context ());
-      lock_acquire (&q->lock);
       wait (q, &q->not_empty);
-      lock_release (&q->lock);
     }
   
   byte = q->buf[q->tail];
@@ -64,9 +62,7 @@ intq_putc (struct intq *q, uint8_t byte)
   while (intq_full (q))
     {
       ASSERT (!intr_context ());
-      lock_acquire (&q->lock);
       wait (q, &q->not_full);
-      lock_release (&q->lock);
     }
 
   q->buf[q->head] = byte;
@@ -81,34 +77,29 @@ next (int pos)
   return (pos + 1) % INTQ_BUFSIZE;
 }
 
-/* WAITER must be the address of Q's not_empty or not_full
+/* WAITERS must be the address of Q's not_empty or not_full
    member.  Waits until the given condition is true. */
 static void
-wait (struct intq *q UNUSED, struct thread **waiter) 
+wait (struct intq *q UNUSED, struct wait_queue *waiters) 
 {
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT ((waiter == &q->not_empty && intq_empty (q))
-          || (waiter == &q->not_full && intq_full (q)));
+  ASSERT ((waiters == &q->not_empty && intq_empty (q))
+          || (waiters == &q->not_full && intq_full (q)));
 
-  *waiter = thread_current ();
-  thread_block ();
+  wait_queue_wait (waiters);
 }
 
-/* WAITER must be the address of Q's not_empty or not_full
-   member, and the associated condition must be true.  If a
-   thread is waiting for the condition, wakes it up and resets
-   the waiting thread. */
+/* WAITERS must be the address of Q's not_empty or not_full
+   member, and the associated condition must be true.  If any
+   thread is waiting for the condition, wakes the one with the
+   highest priority. */
 static void
-signal (struct intq *q UNUSED, struct thread **waiter) 
+signal (struct intq *q UNUSED, struct wait_queue *waiters) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT ((waiter == &q->not_empty && !intq_empty (q))
-          || (waiter == &q->not_full && !intq_full (q)));
+  ASSERT ((waiters == &q->not_empty && !intq_empty (q))
+          || (waiters == &q->not_full && !intq_full (q)));
 
-  if (*waiter != NULL) 
-    {
-      thread_unblock (*waiter);
-      *waiter = NULL;
-    }
+  wait_queue_wake (waiters);
 }
@@ -24,9 +24,8 @@
 struct intq
   {
     /* Waiting threads. */
-    struct lock lock;           /* Only one thread may wait at once. */
-    struct thread *not_full;    /* Thread waiting for not-full condition. */
-    struct thread *not_empty;   /* Thread waiting for not-empty condition. */
+    struct wait_queue not_full; /* Threads waiting for not-full condition. */
+    struct wait_queue not_empty; /* Threads waiting for not-empty condition. */
 
     /* Queue. */
     uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
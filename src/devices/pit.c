@@ -15,9 +15,6 @@
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /*!< Counter port. */
 /*! @} */
 
-/*! PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /*! Configure the given CHANNEL in the PIT.  In a PC, the PIT's
     three output channels are hooked up like this:
 
@@ -79,3 +76,38 @@ void pit_configure_channel(int channel, int mode, int frequency) {
     intr_set_level(old_level);
 }
 
+
+/*! Starts CHANNEL counting down from COUNT in mode 0, "interrupt on
+    terminal count": its output goes high, raising an interrupt on
+    channel 0, once COUNT PIT cycles have elapsed, and then stays high.
+    Programming the channel again with pit_configure_channel() returns
+    it to periodic operation. */
+void pit_start_oneshot(int channel, uint16_t count) {
+    enum intr_level old_level;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
+    outb(PIT_PORT_COUNTER(channel), count);
+    outb(PIT_PORT_COUNTER(channel), count >> 8);
+    intr_set_level(old_level);
+}
+
+/*! Returns the current value of CHANNEL's down counter.  In mode 0 the
+    counter keeps counting down, wrapping past 0, after it fires. */
+uint16_t pit_read_count(int channel) {
+    enum intr_level old_level;
+    uint16_t count;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    /* A counter latch command freezes the value for the two reads. */
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, channel << 6);
+    count = inb(PIT_PORT_COUNTER(channel));
+    count |= inb(PIT_PORT_COUNTER(channel)) << 8;
+    intr_set_level(old_level);
+
+    return count;
+}
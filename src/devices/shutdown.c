@@ -5,7 +5,11 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -109,6 +113,10 @@ void shutdown_power_off(void) {
 static void print_stats(void) {
     timer_print_stats();
     thread_print_stats();
+    lock_print_stats();
+    palloc_print_stats();
+    kmem_print_stats();
+    workqueue_print_stats();
 #ifdef FILESYS
     block_print_stats();
 #endif
@@ -9,9 +9,11 @@
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "devices/tsc.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 #include <list.h>
   
@@ -22,16 +24,93 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/*! List of sleeping threads. */
-static struct list sleep_list;
-
-/*! Number of timer ticks since OS booted. */
+/*! Timeouts, including those of sleeping threads, are kept in a
+    hierarchical timing wheel, so that timer_sleep() and timeout_add()
+    insert in constant time and timer_interrupt() only touches the
+    timeouts that are due.
+
+    A timeout due in fewer than WHEEL0_SIZE ticks sits in the level 0
+    slot for its exact tick.  One due in fewer than WHEEL0_SIZE *
+    WHEEL1_SIZE ticks sits in the level 1 slot covering its tick, and is
+    moved down to level 0 when the wheel reaches that range.  Anything
+    later waits in far_list, which is redistributed once per full turn
+    of level 1. @{ */
+#define WHEEL0_BITS 8
+#define WHEEL1_BITS 6
+#define WHEEL0_SIZE (1 << WHEEL0_BITS)
+#define WHEEL1_SIZE (1 << WHEEL1_BITS)
+#define WHEEL_SPAN (WHEEL0_SIZE * WHEEL1_SIZE)
+#define WHEEL0_SLOT(T) ((T) & (WHEEL0_SIZE - 1))
+#define WHEEL1_SLOT(T) (((T) >> WHEEL0_BITS) & (WHEEL1_SIZE - 1))
+
+static struct list wheel0[WHEEL0_SIZE];
+static struct list wheel1[WHEEL1_SIZE];
+static struct list far_list;
+/*! @} */
+
+/*! Timeouts that are due, waiting for timeout_work to run them in a
+    worker thread. */
+static struct list expired_timeouts;
+static struct work timeout_work;
+
+/*! Number of timer ticks since OS booted.  Written only by the timer,
+    with interrupts off, under ticks_seq. */
 static int64_t ticks;
+static struct seqlock ticks_seq = SEQLOCK_INITIALIZER;
+
+/*! If true, the idle thread stops the periodic tick while it sleeps.
+    Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/*! Tickless idle.  The PIT's 16-bit counter holds at most
+    TICKLESS_MAX_TICKS ticks' worth of cycles, so a long idle period is
+    covered by a series of one-shots.  oneshot_ticks is the length of
+    the one-shot in progress, or 0 while the PIT is periodic. @{ */
+#define PIT_CYCLES_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define TICKLESS_MAX_TICKS (UINT16_MAX / PIT_CYCLES_PER_TICK)
+
+static int oneshot_ticks;
+/*! @} */
+
+/*! High-resolution timers, soonest first.  Those due before the next
+    tick are served by splitting the tick: the PIT leaves periodic mode
+    and runs a one-shot to the timer's expiry, then more one-shots to
+    later timers or to the tick boundary, where it goes back to being
+    periodic.  While split_active, split_cycles is the number of PIT
+    cycles from the end of the one-shot in progress to the boundary,
+    which is 0 for the final one-shot.  Accessed with interrupts
+    off. @{ */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+#define HRTIMER_MIN_CYCLES 12   /*!< Shortest one-shot, about 10 us. */
+
+static struct list hrtimers;
+static bool split_active;
+static unsigned split_cycles;
+static unsigned split_oneshot;  /*!< Length of the one-shot in progress. */
+static unsigned hrtimer_fired;  /*!< # of high-resolution timers fired. */
+/*! @} */
+
+/*! Longest time spent in timer_interrupt(), in PIT cycles, measured
+    only while the PIT is periodic. */
+static unsigned max_interrupt_cycles;
 
 /*! Number of loops per timer tick.  Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static void wheel_insert(struct timeout *t);
+static void wheel_cascade(struct list *slot);
+static void timer_advance(void);
+static int64_t next_deadline(int64_t limit);
+static void resume_periodic(int skipped);
+static void hrtimer_run(void);
+static void hrtimer_program(unsigned to_boundary);
+static bool hrtimer_sooner(const struct list_elem *, const struct list_elem *,
+                           void *aux);
+static void hrsleep_wake(void *sema);
+static void sleep_wake(void *thread);
+static void timeout_expire(struct timeout *t);
+static void timeout_run(void *aux);
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
@@ -40,8 +119,17 @@ static void real_time_delay(int64_t num, int32_t denom);
 /*! Sets up the timer to interrupt TIMER_FREQ times per second,
     and registers the corresponding interrupt. */
 void timer_init(void) {
-    /* Set up sleep list. */
-    list_init(&sleep_list); 
+    int i;
+
+    /* Set up timing wheel. */
+    for (i = 0; i < WHEEL0_SIZE; i++)
+        list_init(&wheel0[i]);
+    for (i = 0; i < WHEEL1_SIZE; i++)
+        list_init(&wheel1[i]);
+    list_init(&far_list);
+    list_init(&expired_timeouts);
+    work_init(&timeout_work, timeout_run, NULL);
+    list_init(&hrtimers);
     pit_configure_channel(0, 2, TIMER_FREQ);
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
@@ -73,9 +161,14 @@ void timer_calibrate(void) {
 
 /*! Returns the number of timer ticks since the OS booted. */
 int64_t timer_ticks(void) {
-    enum intr_level old_level = intr_disable();
-    int64_t t = ticks;
-    intr_set_level(old_level);
+    unsigned seq;
+    int64_t t;
+
+    /* Reading 64 bits takes two loads, which a tick may fall between. */
+    do {
+        seq = seqlock_read_begin(&ticks_seq);
+        t = ticks;
+    } while (seqlock_read_retry(&ticks_seq, seq));
     return t;
 }
 
@@ -85,27 +178,147 @@ int64_t timer_elapsed(int64_t then) {
     return timer_ticks() - then;
 }
 
+/*! Returns the number of nanoseconds since the OS booted, as measured
+    by the TSC.  Unlike timer_ticks(), this advances between ticks. */
+int64_t timer_now(void) {
+    return tsc_to_ns(tsc_read());
+}
+
+/*! Initializes high-resolution timer T to call FUNC, passing AUX, when
+    it fires. */
+void hrtimer_init(struct hrtimer *t, hrtimer_func *func, void *aux) {
+    ASSERT(t != NULL && func != NULL);
+
+    t->func = func;
+    t->aux = aux;
+    t->pending = false;
+}
+
+/*! Starts T, which must not be pending, to fire once timer_now() reaches
+    EXPIRES.  T's function runs in the timer interrupt, so it must not
+    sleep.  May be called from an interrupt handler. */
+void hrtimer_start(struct hrtimer *t, int64_t expires) {
+    enum intr_level old_level;
+
+    ASSERT(!t->pending);
+
+    old_level = intr_disable();
+    t->expires = expires;
+    t->pending = true;
+    list_insert_ordered(&hrtimers, &t->elem, hrtimer_sooner, NULL);
+
+    /* The tick may need splitting sooner than planned.  A tickless
+       one-shot has to end first; if it has already fired, the tick it
+       delivers will take care of T. */
+    if (oneshot_ticks != 0)
+        timer_idle_exit();
+    if (oneshot_ticks == 0 && list_front(&hrtimers) == &t->elem) {
+        unsigned count = pit_read_count(0);
+
+        /* A one-shot that has wrapped around, or a periodic count just
+           reloaded, means a timer interrupt is about to be delivered,
+           and it reprograms the PIT itself. */
+        if (split_active && count <= split_oneshot)
+            hrtimer_program(count + split_cycles);
+        else if (!split_active
+                 && count + HRTIMER_MIN_CYCLES < PIT_CYCLES_PER_TICK)
+            hrtimer_program(count);
+    }
+    intr_set_level(old_level);
+}
+
+/*! Stops T from firing.  Returns true if T was pending, false if it had
+    already fired or was never started. */
+bool hrtimer_cancel(struct hrtimer *t) {
+    enum intr_level old_level;
+    bool was_pending;
+
+    old_level = intr_disable();
+    was_pending = t->pending;
+    if (was_pending) {
+        list_remove(&t->elem);
+        t->pending = false;
+    }
+    intr_set_level(old_level);
+    return was_pending;
+}
+
 /*! Sleeps for approximately TICKS timer ticks.  Interrupts must
     be turned on. */
 void timer_sleep(int64_t ticks) {
     int64_t start = timer_ticks();
+    struct timeout wake;
 
     ASSERT(intr_get_level() == INTR_ON);
+    if (ticks <= 0)
+        return;
 
-    /* Determine wake up time. */
-    struct thread *t = thread_current();
-    t->wake_time = start + ticks;
+    /* Determine wake up time.  The wakeup must not wait for a worker
+       thread, so it runs in the timer interrupt itself. */
+    wake.expires = start + ticks;
+    wake.func = sleep_wake;
+    wake.aux = thread_current();
+    wake.in_interrupt = true;
 
     /** 
-     * Add thread to sleep list.
-     * Note: Modifying sleep_list is critical code. 
+     * Add thread to the timing wheel and sleep by context switching.
+     * Note: Modifying the wheel is critical code, and the thread must
+     * be blocked before the timer can wake it up.
      */
     enum intr_level old_level = intr_disable();
-    list_push_back(&sleep_list, &t->sleepelem);
+    if (wake.expires > timer_ticks()) {
+        wake.pending = true;
+        wheel_insert(&wake);
+        thread_sleep();
+    }
+    intr_set_level(old_level);
+}
+
+/*! Initializes timeout T to call FUNC, passing AUX, when it expires. */
+void timeout_init(struct timeout *t, timeout_func *func, void *aux) {
+    ASSERT(t != NULL && func != NULL);
+
+    t->func = func;
+    t->aux = aux;
+    t->pending = false;
+    t->in_interrupt = false;
+}
+
+/*! Arranges for timeout T, which must not be pending, to expire TICKS
+    timer ticks from now.  Its function is then called once, in a worker
+    thread with interrupts on.  A TICKS of 0 or less expires T at once.
+    T may be added again once its function has started, including from
+    the function itself.  May be called from an interrupt handler. */
+void timeout_add(struct timeout *t, int64_t ticks) {
+    enum intr_level old_level;
+
+    ASSERT(!t->pending);
+
+    old_level = intr_disable();
+    t->pending = true;
+    t->expires = timer_ticks() + ticks;
+    if (ticks > 0)
+        wheel_insert(t);
+    else
+        timeout_expire(t);
+    intr_set_level(old_level);
+}
+
+/*! Cancels timeout T.  Returns true if this kept T's function from
+    being called, false if T was not pending because it had never been
+    added, had been canceled, or its function had already started. */
+bool timeout_cancel(struct timeout *t) {
+    enum intr_level old_level;
+    bool was_pending;
+
+    old_level = intr_disable();
+    was_pending = t->pending;
+    if (was_pending) {
+        list_remove(&t->elem);
+        t->pending = false;
+    }
     intr_set_level(old_level);
-    
-    /* Sleep thread by context switching. */
-    thread_sleep();
+    return was_pending;
 }
 
 /*! Sleeps for approximately MS milliseconds.  Interrupts must be turned on. */
@@ -155,42 +368,289 @@ void timer_ndelay(int64_t ns) {
 /*! Prints timer statistics. */
 void timer_print_stats(void) {
     printf("Timer: %"PRId64" ticks\n", timer_ticks());
+    printf("Timer: longest interrupt handler %"PRIu64" us\n",
+           (uint64_t) max_interrupt_cycles * 1000000 / PIT_HZ);
+    printf("Timer: %u high-resolution timers fired\n", hrtimer_fired);
 }
 
+/*! Called by the idle thread, with interrupts off, just before it
+    halts.  In tickless mode, replaces the periodic tick by a one-shot
+    that fires at the next sleeper's wake-up time or after
+    TICKLESS_MAX_TICKS, whichever comes first. */
+void timer_idle_enter(void) {
+    int64_t deadline;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!timer_tickless || oneshot_ticks != 0 || split_active
+        || !list_empty(&hrtimers))
+        return;
+
+    deadline = next_deadline(ticks + TICKLESS_MAX_TICKS);
+    if (deadline - ticks < 2)
+        return;
+
+    oneshot_ticks = deadline - ticks;
+    pit_start_oneshot(0, oneshot_ticks * PIT_CYCLES_PER_TICK);
+}
+
+/*! Called with interrupts off on entry to every device interrupt
+    other than the timer's, any of which may end a tickless idle
+    period, while the idle thread is still running.  If the one-shot is
+    still counting, credits the whole ticks that have passed and goes
+    back to the periodic tick.  The fraction of a tick in progress is
+    lost. */
+void timer_idle_exit(void) {
+    unsigned count, elapsed;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (oneshot_ticks == 0)
+        return;
+
+    count = oneshot_ticks * PIT_CYCLES_PER_TICK;
+    elapsed = count - pit_read_count(0);
+    if (elapsed >= count) {
+        /* The counter wrapped, so the one-shot has fired and its
+           interrupt is pending.  timer_interrupt() will finish up. */
+        return;
+    }
+    resume_periodic(elapsed / PIT_CYCLES_PER_TICK);
+}
+
 /*! Timer interrupt handler. */
 static void timer_interrupt(struct intr_frame *args UNUSED) {
+    unsigned entry_count = 0;
+
+    if (split_active) {
+        if (split_cycles != 0) {
+            /* Partway through a split tick: only hrtimers are due. */
+            unsigned to_boundary = split_cycles;
+            hrtimer_run();
+            hrtimer_program(to_boundary);
+            return;
+        }
+
+        /* The last one-shot of a split tick ended on the boundary. */
+        split_active = false;
+        pit_configure_channel(0, 2, TIMER_FREQ);
+    }
+    else if (oneshot_ticks != 0) {
+        /* All but the last tick of the one-shot were skipped. */
+        resume_periodic(oneshot_ticks - 1);
+    }
+    else
+        entry_count = pit_read_count(0);
+
+    timer_advance();
+    thread_tick();
+    hrtimer_run();
+    if (!list_empty(&hrtimers) && oneshot_ticks == 0)
+        hrtimer_program(pit_read_count(0));
+
+    /* The periodic counter counts down, and reloads at each tick. */
+    if (entry_count != 0) {
+        unsigned exit_count = pit_read_count(0);
+        if (exit_count < entry_count
+            && entry_count - exit_count > max_interrupt_cycles)
+            max_interrupt_cycles = entry_count - exit_count;
+    }
+}
+
+/*! Advances the clock by one tick and wakes the sleepers now due. */
+static void timer_advance(void) {
+    seqlock_write_begin(&ticks_seq);
     ticks++;
+    seqlock_write_end(&ticks_seq);
+
+    /* Move timeouts down the wheel as their range comes up.  Far
+       timeouts go first, since some of them may land in the level 1
+       slot that is cascaded next. */
+    if ((ticks & (WHEEL_SPAN - 1)) == 0)
+        wheel_cascade(&far_list);
+    if (WHEEL0_SLOT(ticks) == 0)
+        wheel_cascade(&wheel1[WHEEL1_SLOT(ticks)]);
+
+    /* Every timeout in this tick's slot is due. */
+    struct list *slot = &wheel0[WHEEL0_SLOT(ticks)];
+    while (!list_empty(slot)) {
+        struct timeout *t = list_entry(list_pop_front(slot),
+                                       struct timeout, elem);
+        ASSERT(t->expires == ticks);
+        timeout_expire(t);
+    }
+}
+
+/*! Handles timeout T, which is due and no longer in the wheel: a
+    sleeping thread's is run on the spot, and any other is handed to a
+    worker thread.  Interrupts must be off. */
+static void timeout_expire(struct timeout *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (t->in_interrupt) {
+        t->pending = false;
+        t->func(t->aux);
+    }
+    else {
+        list_push_back(&expired_timeouts, &t->elem);
+        work_queue(&timeout_work);
+    }
+}
+
+/*! Runs the functions of the expired timeouts, with interrupts on. */
+static void timeout_run(void *aux UNUSED) {
+    for (;;) {
+        enum intr_level old_level = intr_disable();
+        struct timeout *t;
+
+        if (list_empty(&expired_timeouts)) {
+            intr_set_level(old_level);
+            break;
+        }
+        t = list_entry(list_pop_front(&expired_timeouts),
+                       struct timeout, elem);
+        t->pending = false;
+        intr_set_level(old_level);
+
+        t->func(t->aux);
+    }
+}
+
+/*! Wakes THREAD, whose timer_sleep() has run out. */
+static void sleep_wake(void *thread) {
+    thread_unblock(thread);
+}
 
-    /* Compute advanced scheduler values. */
-    thread_current()->recent_cpu += fixed_point(1);
-    if (ticks % TIMER_FREQ == 0) {
-        update_load_avg();
-        update_recent_cpus();
-    }
-    if (ticks % 4 == 0) { 
-        update_bsd_priorities();
-    }
-
-    /* Wake threads up if it is time to. */
-    if (!list_empty(&sleep_list)) {
-        struct list_elem *cur = list_begin(&sleep_list); 
-        while (cur != list_end(&sleep_list)) {
-            struct thread *t = list_entry(cur, struct thread, sleepelem);
-
-            /* 
-             * If wake_time has passed, unblock the thread, and remove
-             * from the sleep list.
-             */
-            if (ticks >= t->wake_time) { 
-                thread_unblock(t);
-                cur = list_remove(cur);
-            }
-            else {
-                cur = list_next(cur);
-            }
+/*! Fires every high-resolution timer that is due.  Interrupts must be
+    off. */
+static void hrtimer_run(void) {
+    int64_t now = timer_now();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (!list_empty(&hrtimers)) {
+        struct hrtimer *t = list_entry(list_front(&hrtimers),
+                                       struct hrtimer, elem);
+        if (t->expires > now)
+            break;
+        list_pop_front(&hrtimers);
+        t->pending = false;
+        hrtimer_fired++;
+        t->func(t->aux);
+    }
+}
+
+/*! Programs the PIT for the soonest high-resolution timer, given that
+    the next tick boundary is TO_BOUNDARY PIT cycles away.  If the timer
+    is due before the boundary, starts a one-shot to it, splitting the
+    tick.  Otherwise, if the tick is already split, finishes it with a
+    one-shot to the boundary.  Interrupts must be off, and no tickless
+    one-shot may be in progress. */
+static void hrtimer_program(unsigned to_boundary) {
+    unsigned cycles = to_boundary;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(oneshot_ticks == 0);
+
+    if (!list_empty(&hrtimers)) {
+        struct hrtimer *t = list_entry(list_front(&hrtimers),
+                                       struct hrtimer, elem);
+        int64_t delta = t->expires - timer_now();
+
+        if (delta < NS_PER_TICK) {
+            unsigned c = delta > 0 ? delta * PIT_HZ / 1000000000 : 0;
+            if (c < HRTIMER_MIN_CYCLES)
+                c = HRTIMER_MIN_CYCLES;
+            if (c + HRTIMER_MIN_CYCLES < to_boundary)
+                cycles = c;
         }
     }
-    thread_tick();
+
+    /* The periodic tick comes soon enough. */
+    if (cycles == to_boundary && !split_active)
+        return;
+
+    split_active = true;
+    split_cycles = to_boundary - cycles;
+    split_oneshot = cycles;
+    pit_start_oneshot(0, cycles);
+}
+
+/*! Orders high-resolution timers by expiry. */
+static bool hrtimer_sooner(const struct list_elem *a,
+                           const struct list_elem *b, void *aux UNUSED) {
+    return list_entry(a, struct hrtimer, elem)->expires
+           < list_entry(b, struct hrtimer, elem)->expires;
+}
+
+/*! Wakes the thread sleeping in real_time_sleep() on SEMA. */
+static void hrsleep_wake(void *sema) {
+    sema_up(sema);
+}
+
+/*! Returns the first tick after the current one, and no later than
+    LIMIT, at which a sleeper may be due.  Level 0 is searched directly.
+    A cascade may bring a sleeper due soon after it, so the next cascade
+    also ends the search. */
+static int64_t next_deadline(int64_t limit) {
+    int64_t t;
+
+    for (t = ticks + 1; t < limit; t++) {
+        if (WHEEL0_SLOT(t) == 0 || !list_empty(&wheel0[WHEEL0_SLOT(t)]))
+            return t;
+    }
+    return limit;
+}
+
+/*! Ends the one-shot in progress, whose first SKIPPED ticks passed
+    while the idle thread slept, and goes back to the periodic tick.
+    The skipped ticks are replayed so that the clock, the sleepers and
+    the idle and scheduler statistics all catch up. */
+static void resume_periodic(int skipped) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    oneshot_ticks = 0;
+    pit_configure_channel(0, 2, TIMER_FREQ);
+    while (skipped-- > 0) {
+        timer_advance();
+        thread_idle_tick();
+    }
+}
+
+/*! Files timeout T into the timing wheel by its expiry, which must be
+    in the future.  Interrupts must be off. */
+static void wheel_insert(struct timeout *t) {
+    int64_t delta = t->expires - ticks;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(delta > 0);
+
+    if (delta < WHEEL0_SIZE)
+        list_push_back(&wheel0[WHEEL0_SLOT(t->expires)], &t->elem);
+    else if (delta < WHEEL_SPAN)
+        list_push_back(&wheel1[WHEEL1_SLOT(t->expires)], &t->elem);
+    else
+        list_push_back(&far_list, &t->elem);
+}
+
+/*! Refiles every timeout in SLOT into the wheel relative to the current
+    tick.  A timeout due on the current tick goes into the current level
+    0 slot, which timer_interrupt() empties right afterward. */
+static void wheel_cascade(struct list *slot) {
+    struct list pending;
+
+    list_init(&pending);
+    while (!list_empty(slot))
+        list_push_back(&pending, list_pop_front(slot));
+
+    while (!list_empty(&pending)) {
+        struct timeout *t = list_entry(list_pop_front(&pending),
+                                       struct timeout, elem);
+        if (t->expires == ticks)
+            list_push_back(&wheel0[WHEEL0_SLOT(ticks)], &t->elem);
+        else
+            wheel_insert(t);
+    }
 }
 
 /*! Returns true if LOOPS iterations waits for more than one timer tick,
@@ -236,9 +696,16 @@ static void real_time_sleep(int64_t num, int32_t denom) {
            because it will yield the CPU to other processes. */                
         timer_sleep(ticks); 
     }
-    else {
-        /* Otherwise, use a busy-wait loop for more accurate sub-tick timing. */
-        real_time_delay(num, denom); 
+    else if (num > 0) {
+        /* Otherwise, block until a high-resolution timer fires.  NUM is
+           less than DENOM / TIMER_FREQ, so this does not overflow. */
+        struct hrtimer timer;
+        struct semaphore done;
+
+        sema_init(&done, 0);
+        hrtimer_init(&timer, hrsleep_wake, &done);
+        hrtimer_start(&timer, timer_now() + num * 1000000000 / denom);
+        sema_down(&done);
     }
 }
 
@@ -1,17 +1,56 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /*! Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+extern bool timer_tickless;
+
+/*! Function called when a timeout expires. */
+typedef void timeout_func(void *aux);
+
+/*! A callout: a function to be called once, some number of timer ticks
+    from now.  The owner allocates it, typically statically or inside
+    the object the function works on. */
+struct timeout {
+    struct list_elem elem;      /*!< Element in the timing wheel. */
+    int64_t expires;            /*!< Tick at which it is due. */
+    timeout_func *func;         /*!< Function to call. */
+    void *aux;                  /*!< Argument to FUNC. */
+    bool pending;               /*!< Added and not yet run or canceled. */
+    bool in_interrupt;          /*!< Run FUNC in the timer interrupt
+                                     (timer.c internal use). */
+};
+
+/*! Function called when a high-resolution timer fires. */
+typedef void hrtimer_func(void *aux);
+
+/*! A high-resolution timer, which calls a function from the timer
+    interrupt at a time given in nanoseconds, rather than on a tick. */
+struct hrtimer {
+    struct list_elem elem;      /*!< Element in the pending list. */
+    int64_t expires;            /*!< timer_now() at which to fire. */
+    hrtimer_func *func;         /*!< Function to call. */
+    void *aux;                  /*!< Argument to FUNC. */
+    bool pending;               /*!< Started and not fired yet. */
+};
+
 void timer_init(void);
 void timer_calibrate(void);
 
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
+int64_t timer_now(void);
+
+/* High-resolution timers. */
+void hrtimer_init(struct hrtimer *, hrtimer_func *, void *aux);
+void hrtimer_start(struct hrtimer *, int64_t expires);
+bool hrtimer_cancel(struct hrtimer *);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
@@ -19,11 +58,20 @@ void timer_msleep(int64_t milliseconds);
 void timer_usleep(int64_t microseconds);
 void timer_nsleep(int64_t nanoseconds);
 
+/* Callouts, run by a worker thread. */
+void timeout_init(struct timeout *, timeout_func *, void *aux);
+void timeout_add(struct timeout *, int64_t ticks);
+bool timeout_cancel(struct timeout *);
+
 /* Busy waits. */
 void timer_mdelay(int64_t milliseconds);
 void timer_udelay(int64_t microseconds);
 void timer_ndelay(int64_t nanoseconds);
 
+/* Tickless idle. */
+void timer_idle_enter(void);
+void timer_idle_exit(void);
+
 void timer_print_stats(void);
 
 #endif /* devices/timer.h */
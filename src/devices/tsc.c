@@ -0,0 +1,58 @@
+/*! \file tsc.c
+ *
+ * Time-stamp counter clock source.  The TSC gives sub-microsecond
+ * timestamps cheaply, but its rate depends on the CPU, so it is
+ * measured against the timer at boot.
+ */
+
+#include "devices/tsc.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+
+/*! Number of timer ticks to measure the TSC over. */
+#define CALIBRATE_TICKS 10
+
+/*! TSC cycles per second.  Until tsc_calibrate() runs, a 1 GHz counter
+    is assumed, so that cycle counts read as nanoseconds. */
+static uint64_t hz = 1000000000;
+
+/*! Measures the TSC rate against the timer.  Interrupts must be on. */
+void tsc_calibrate(void) {
+    int64_t start;
+    uint64_t tsc_start;
+
+    ASSERT(intr_get_level() == INTR_ON);
+    printf("Calibrating TSC...  ");
+
+    /* Start on a tick boundary. */
+    start = timer_ticks();
+    while (timer_ticks() == start)
+        continue;
+
+    start = timer_ticks();
+    tsc_start = tsc_read();
+    while (timer_elapsed(start) < CALIBRATE_TICKS)
+        continue;
+    hz = (tsc_read() - tsc_start) * TIMER_FREQ / CALIBRATE_TICKS;
+
+    printf("%'"PRIu64" Hz.\n", hz);
+}
+
+/*! Returns the number of TSC cycles per second. */
+uint64_t tsc_hz(void) {
+    return hz;
+}
+
+/*! Converts CYCLES of the TSC to nanoseconds. */
+uint64_t tsc_to_ns(uint64_t cycles) {
+    /* Split the conversion so that the product cannot overflow. */
+    return cycles / hz * 1000000000 + cycles % hz * 1000000000 / hz;
+}
+
+/*! Converts CYCLES of the TSC to microseconds. */
+uint64_t tsc_to_us(uint64_t cycles) {
+    return cycles / hz * 1000000 + cycles % hz * 1000000 / hz;
+}
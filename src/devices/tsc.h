@@ -0,0 +1,19 @@
+#ifndef DEVICES_TSC_H
+#define DEVICES_TSC_H
+
+#include <stdint.h>
+
+/*! Returns the CPU's time-stamp counter, which counts CPU cycles
+    since reset. */
+static inline uint64_t tsc_read(void) {
+    uint64_t tsc;
+    asm volatile ("rdtsc" : "=A" (tsc));
+    return tsc;
+}
+
+void tsc_calibrate(void);
+uint64_t tsc_hz(void);
+uint64_t tsc_to_ns(uint64_t cycles);
+uint64_t tsc_to_us(uint64_t cycles);
+
+#endif /* devices/tsc.h */
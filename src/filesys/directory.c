@@ -4,7 +4,7 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /*! A directory. */
 struct dir {
@@ -19,6 +19,16 @@ struct dir_entry {
     bool in_use;                        /*!< In use or free? */
 };
 
+/*! Cache that open directories are allocated from. */
+static struct kmem_cache *dir_cache;
+
+/*! Initializes the directory module. */
+void dir_init(void) {
+    dir_cache = kmem_cache_create("dir", sizeof(struct dir), NULL);
+    if (dir_cache == NULL)
+        PANIC("Failed to create directory cache");
+}
+
 /*! Creates a directory with space for ENTRY_CNT entries in the
     given SECTOR.  Returns true if successful, false on failure. */
 bool dir_create(block_sector_t sector, size_t entry_cnt) {
@@ -28,7 +38,7 @@ bool dir_create(block_sector_t sector, size_t entry_cnt) {
 /*! Opens and returns the directory for the given INODE, of which
     it takes ownership.  Returns a null pointer on failure. */
 struct dir * dir_open(struct inode *inode) {
-    struct dir *dir = calloc(1, sizeof(*dir));
+    struct dir *dir = kmem_cache_alloc(dir_cache);
     if (inode != NULL && dir != NULL) {
         dir->inode = inode;
         dir->pos = 0;
@@ -36,7 +46,7 @@ struct dir * dir_open(struct inode *inode) {
     }
     else {
         inode_close(inode);
-        free(dir);
+        kmem_cache_free(dir_cache, dir);
         return NULL; 
     }
 }
@@ -57,7 +67,7 @@ struct dir * dir_reopen(struct dir *dir) {
 void dir_close(struct dir *dir) {
     if (dir != NULL) {
         inode_close(dir->inode);
-        free(dir);
+        kmem_cache_free(dir_cache, dir);
     }
 }
 
@@ -6,6 +6,8 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /*! Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -32,6 +34,8 @@ struct inode {
     int open_cnt;                       /*!< Number of openers. */
     bool removed;                       /*!< True if deleted, false otherwise. */
     int deny_write_cnt;                 /*!< 0: writes ok, >0: deny writes. */
+    bool loading;                       /*!< DATA not yet read from disk. */
+    struct semaphore loaded;            /*!< Upped once DATA is read. */
     struct inode_disk data;             /*!< Inode content. */
 };
 
@@ -48,12 +52,49 @@ static block_sector_t byte_to_sector(const struct inode *inode, off_t pos) {
 }
 
 /*! List of open inodes, so that opening a single inode twice
-    returns the same `struct inode'. */
+    returns the same `struct inode'.  Most opens find the inode
+    already there, so lookups only take open_inodes_lock for reading. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
+
+/*! Cache that in-memory inodes are allocated from. */
+static struct kmem_cache *inode_cache;
+
+static struct inode *open_inodes_find(block_sector_t sector);
+static struct inode *inode_wait_loaded(struct inode *);
 
 /*! Initializes the inode module. */
 void inode_init(void) {
     list_init(&open_inodes);
+    rwlock_init(&open_inodes_lock);
+    inode_cache = kmem_cache_create("inode", sizeof(struct inode), NULL);
+    if (inode_cache == NULL)
+        PANIC("Failed to create inode cache");
+}
+
+/*! Returns the open inode for SECTOR, reopened, or a null pointer if
+    there is none.  open_inodes_lock must be held. */
+static struct inode *open_inodes_find(block_sector_t sector) {
+    struct list_elem *e;
+
+    for (e = list_begin(&open_inodes); e != list_end(&open_inodes);
+         e = list_next(e)) {
+        struct inode *inode = list_entry(e, struct inode, elem);
+        if (inode->sector == sector)
+            return inode_reopen(inode);
+    }
+    return NULL;
+}
+
+/*! Waits until INODE, just found in open_inodes, has been read from
+    disk by the thread that opened it first, and returns it.  Each
+    waiter passes the semaphore on to the next. */
+static struct inode *inode_wait_loaded(struct inode *inode) {
+    if (inode->loading) {
+        sema_down(&inode->loaded);
+        sema_up(&inode->loaded);
+    }
+    return inode;
 }
 
 /*! Initializes an inode with LENGTH bytes of data and
@@ -96,38 +137,54 @@ bool inode_create(block_sector_t sector, off_t length) {
     and returns a `struct inode' that contains it.
     Returns a null pointer if memory allocation fails. */
 struct inode * inode_open(block_sector_t sector) {
-    struct list_elem *e;
     struct inode *inode;
 
     /* Check whether this inode is already open. */
-    for (e = list_begin(&open_inodes); e != list_end(&open_inodes);
-         e = list_next(e)) {
-        inode = list_entry(e, struct inode, elem);
-        if (inode->sector == sector) {
-            inode_reopen(inode);
-            return inode; 
-        }
+    rwlock_read_acquire(&open_inodes_lock);
+    inode = open_inodes_find(sector);
+    rwlock_read_release(&open_inodes_lock);
+    if (inode != NULL)
+        return inode_wait_loaded(inode);
+
+    /* Someone else may have opened it while we held no lock. */
+    rwlock_write_acquire(&open_inodes_lock);
+    inode = open_inodes_find(sector);
+    if (inode != NULL) {
+        rwlock_write_release(&open_inodes_lock);
+        return inode_wait_loaded(inode);
     }
 
     /* Allocate memory. */
-    inode = malloc(sizeof *inode);
-    if (inode == NULL)
+    inode = kmem_cache_alloc(inode_cache);
+    if (inode == NULL) {
+        rwlock_write_release(&open_inodes_lock);
         return NULL;
+    }
 
-    /* Initialize. */
+    /* Initialize, and publish the inode before reading it, so that
+       the list is not held up by the disk.  Anyone who opens it
+       meanwhile waits for the read to finish. */
     list_push_front(&open_inodes, &inode->elem);
     inode->sector = sector;
     inode->open_cnt = 1;
     inode->deny_write_cnt = 0;
     inode->removed = false;
+    inode->loading = true;
+    sema_init(&inode->loaded, 0);
+    rwlock_write_release(&open_inodes_lock);
+
     block_read(fs_device, inode->sector, &inode->data);
+    barrier();
+    inode->loading = false;
+    sema_up(&inode->loaded);
     return inode;
 }
 
-/*! Reopens and returns INODE. */
+/*! Reopens and returns INODE.  Several readers of open_inodes may
+    reopen the same inode at once, so the count is updated atomically. */
 struct inode * inode_reopen(struct inode *inode) {
     if (inode != NULL)
-        inode->open_cnt++;
+        __sync_fetch_and_add(&inode->open_cnt, 1);
     return inode;
 }
 
@@ -144,10 +201,23 @@ void inode_close(struct inode *inode) {
     if (inode == NULL)
         return;
 
-    /* Release resources if this was the last opener. */
-    if (--inode->open_cnt == 0) {
+    /* Drop a reference that is not the last without the list lock.
+       Lookups only add references, so this can never reach 0. */
+    for (;;) {
+        int cnt = inode->open_cnt;
+        if (cnt == 1)
+            break;
+        if (__sync_bool_compare_and_swap(&inode->open_cnt, cnt, cnt - 1))
+            return;
+    }
+
+    /* Release resources if this was the last opener.  Holding the
+       list for writing keeps lookups from reviving INODE meanwhile. */
+    rwlock_write_acquire(&open_inodes_lock);
+    if (__sync_sub_and_fetch(&inode->open_cnt, 1) == 0) {
         /* Remove from inode list and release lock. */
         list_remove(&inode->elem);
+        rwlock_write_release(&open_inodes_lock);
  
         /* Deallocate blocks if removed. */
         if (inode->removed) {
@@ -156,8 +226,10 @@ void inode_close(struct inode *inode) {
                              bytes_to_sectors(inode->data.length)); 
         }
 
-        free(inode); 
+        kmem_cache_free(inode_cache, inode);
     }
+    else
+        rwlock_write_release(&open_inodes_lock);
 }
 
 /*! Marks INODE to be deleted when it is closed by the last caller who
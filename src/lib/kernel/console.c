@@ -56,6 +56,9 @@ static bool use_console_lock;
    counter. */
 static int console_lock_depth;
 
+/* Contention on console_lock. */
+static struct lock_profile console_lock_profile;
+
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
@@ -64,6 +67,7 @@ void
 console_init (void) 
 {
   lock_init (&console_lock);
+  lock_profile (&console_lock, &console_lock_profile, "console");
   use_console_lock = true;
 }
 
@@ -36,6 +36,7 @@ debug_panic (const char *file, int line, const char *function,
       va_end (args);
 
       debug_backtrace ();
+      thread_print_switches ();
     }
   else if (level == 2)
     printf ("Kernel PANIC recursion at %s:%d in %s().\n",
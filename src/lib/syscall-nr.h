@@ -34,7 +34,11 @@ enum {
     SYS_MKDIR,                  /*!< Create a directory. */
     SYS_READDIR,                /*!< Reads a directory entry. */
     SYS_ISDIR,                  /*!< Tests if a fd represents a directory. */
-    SYS_INUMBER                 /*!< Returns the inode number for a fd. */
+    SYS_INUMBER,                /*!< Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_THREAD_STATS,           /*!< Reports the caller's CPU accounting. */
+    SYS_SET_TICKETS             /*!< Sets the caller's stride tickets. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,22 @@
+/*! \file thread-stats.h
+ *
+ * CPU accounting for a single thread, as returned by the thread_stats
+ * system call.
+ */
+
+#ifndef __LIB_THREAD_STATS_H
+#define __LIB_THREAD_STATS_H
+
+#include <stdint.h>
+
+/*! Where one thread's time has gone since it was created. */
+struct thread_stats {
+    uint64_t run_ns;                    /*!< Time spent running. */
+    uint64_t ready_ns;                  /*!< Time spent in the run queue. */
+    uint64_t blocked_ns;                /*!< Time spent blocked. */
+    uint32_t voluntary_switches;        /*!< Times it blocked or exited. */
+    uint32_t involuntary_switches;      /*!< Times it was preempted or
+                                             yielded. */
+};
+
+#endif /* lib/thread-stats.h */
@@ -153,3 +153,10 @@ int inumber(int fd) {
     return syscall1(SYS_INUMBER, fd);
 }
 
+bool thread_stats(struct thread_stats *stats) {
+    return syscall1(SYS_THREAD_STATS, stats);
+}
+
+bool set_tickets(int tickets) {
+    return syscall1(SYS_SET_TICKETS, tickets);
+}
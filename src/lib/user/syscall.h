@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <thread-stats.h>
 
 /*! Process identifier. */
 typedef int pid_t;
@@ -45,5 +46,9 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Extensions. */
+bool thread_stats(struct thread_stats *);
+bool set_tickets(int tickets);
+
 #endif /* lib/user/syscall.h */
 
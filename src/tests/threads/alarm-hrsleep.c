@@ -0,0 +1,67 @@
+/* Checks that sleeps shorter than a timer tick block the thread
+   instead of busy-waiting, and last at least as long as asked.
+
+   A lower-priority thread counts as fast as it can.  It only gets
+   the CPU while the main thread is blocked, so the count must
+   advance across each of the main thread's sleeps. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 50
+#define SLEEP_US 500
+
+static volatile unsigned count;
+static volatile bool stop;
+static struct semaphore counter_done;
+
+static thread_func counter_func;
+
+void
+test_alarm_hrsleep (void) 
+{
+  int64_t slowest = 0;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&counter_done, 0);
+  thread_create ("counter", PRI_DEFAULT - 1, counter_func, NULL);
+
+  msg ("Sleeping %d times for %d us each.", SLEEP_CNT, SLEEP_US);
+  for (i = 0; i < SLEEP_CNT; i++) 
+    {
+      unsigned before = count;
+      int64_t start = timer_now ();
+      int64_t elapsed;
+
+      timer_usleep (SLEEP_US);
+      elapsed = timer_now () - start;
+
+      if (elapsed < SLEEP_US * 1000LL)
+        fail ("sleep %d lasted only %lld ns", i, (long long) elapsed);
+      if (count == before)
+        fail ("sleep %d did not let another thread run", i);
+      if (elapsed > slowest)
+        slowest = elapsed;
+    }
+  msg ("Every sleep blocked for long enough.");
+  msg ("benchmark: longest %d us sleep took %lld us.",
+       SLEEP_US, (long long) slowest / 1000);
+
+  stop = true;
+  sema_down (&counter_done);
+}
+
+static void
+counter_func (void *aux UNUSED) 
+{
+  while (!stop)
+    count++;
+  sema_up (&counter_done);
+}
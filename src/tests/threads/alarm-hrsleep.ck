@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings vary from run to run, so they are not compared.
+@output = grep (!/\) benchmark: /, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-hrsleep) begin
+(alarm-hrsleep) Sleeping 50 times for 500 us each.
+(alarm-hrsleep) Every sleep blocked for long enough.
+(alarm-hrsleep) end
+EOF
+pass;
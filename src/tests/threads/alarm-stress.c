@@ -0,0 +1,134 @@
+/* Puts a couple of thousand threads to sleep at the same time, with
+   wake-up times spread over several hundred ticks, and verifies that
+   none of them wakes up early.  While they are all asleep, compares how
+   many loop iterations a spinning thread gets per tick against an empty
+   sleep queue, as a rough measure of the timer interrupt's cost. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeping threads. */
+#define SLEEPER_CNT 2000
+
+/* Wake-up times are spread over WAKE_SPREAD * WAKE_STEP ticks. */
+#define WAKE_SPREAD 100
+#define WAKE_STEP 7
+
+/* Information about the test. */
+struct stress_test 
+  {
+    struct lock lock;           /* Protects EARLY. */
+    int early;                  /* Number of threads that woke early. */
+    struct semaphore done;      /* Upped once by each sleeper. */
+  };
+
+/* Information about an individual sleeping thread. */
+struct sleeper 
+  {
+    struct stress_test *test;   /* Info shared between all threads. */
+    int64_t wake_time;          /* Tick to wake up on. */
+  };
+
+static void sleeper (void *);
+static long long spin_loops (int tick_cnt);
+
+void
+test_alarm_stress (void) 
+{
+  struct stress_test test;
+  struct sleeper *sleepers;
+  long long idle_loops, busy_loops;
+  int64_t start;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep at the same time.", SLEEPER_CNT);
+  msg ("Wake-up times are spread over %d ticks.", WAKE_SPREAD * WAKE_STEP);
+
+  sleepers = malloc (sizeof *sleepers * SLEEPER_CNT);
+  if (sleepers == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  lock_init (&test.lock);
+  test.early = 0;
+  sema_init (&test.done, 0);
+
+  /* Measure the spinning rate with nobody asleep. */
+  idle_loops = spin_loops (TIMER_FREQ / 5);
+
+  /* Start threads.  Give ourselves plenty of time to create all of them
+     and take a second measurement before the first one is due. */
+  start = timer_ticks () + 10 * TIMER_FREQ;
+  for (i = 0; i < SLEEPER_CNT; i++) 
+    {
+      struct sleeper *s = &sleepers[i];
+      char name[16];
+
+      s->test = &test;
+      s->wake_time = start + (i % WAKE_SPREAD) * WAKE_STEP;
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, s) == TID_ERROR)
+        fail ("couldn't create thread %d", i);
+    }
+
+  /* Let every sleeper go to sleep, then measure again. */
+  timer_sleep (TIMER_FREQ / 10);
+  busy_loops = spin_loops (TIMER_FREQ / 5);
+  if (timer_ticks () >= start)
+    fail ("setup took longer than %d ticks", 10 * TIMER_FREQ);
+  msg ("Spinning thread got %lld loops/tick with no sleepers, "
+       "%lld loops/tick with %d sleepers.",
+       idle_loops, busy_loops, SLEEPER_CNT);
+
+  /* Wait for all the sleepers to wake up. */
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&test.done);
+
+  if (test.early != 0)
+    fail ("%d of %d threads woke up early", test.early, SLEEPER_CNT);
+  msg ("All %d threads woke up, none early.", SLEEPER_CNT);
+
+  free (sleepers);
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *s_) 
+{
+  struct sleeper *s = s_;
+  struct stress_test *test = s->test;
+
+  timer_sleep (s->wake_time - timer_ticks ());
+  if (timer_ticks () < s->wake_time) 
+    {
+      lock_acquire (&test->lock);
+      test->early++;
+      lock_release (&test->lock);
+    }
+  sema_up (&test->done);
+}
+
+/* Spins for TICK_CNT timer ticks, starting at a tick boundary, and
+   returns the average number of loop iterations per tick. */
+static long long
+spin_loops (int tick_cnt) 
+{
+  long long loops = 0;
+  int64_t start;
+
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+
+  start = timer_ticks ();
+  while (timer_elapsed (start) < tick_cnt)
+    loops++;
+  return loops / tick_cnt;
+}
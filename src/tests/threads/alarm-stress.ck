@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The loop counts vary from run to run, so they are not compared.
+@output = grep (!/loops\/tick/, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-stress) begin
+(alarm-stress) Creating 2000 threads to sleep at the same time.
+(alarm-stress) Wake-up times are spread over 700 ticks.
+(alarm-stress) All 2000 threads woke up, none early.
+(alarm-stress) end
+EOF
+pass;
@@ -0,0 +1,117 @@
+/* Adds a few thousand timeouts spread over several seconds, cancels
+   a third of them, and checks that the rest run exactly once, in
+   order of expiry, no earlier than asked and with interrupts on. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define TIMEOUT_CNT 3000
+#define MAX_DELAY 600
+
+struct callout 
+  {
+    struct timeout timeout;
+    int64_t due;                /* Earliest tick it may run. */
+    int runs;                   /* Number of times it ran. */
+  };
+
+static struct callout *callouts;
+static struct semaphore all_done;
+static int remaining;
+static int64_t last_due;
+static bool out_of_order, early, intr_off;
+
+static timeout_func callout_func;
+
+void
+test_alarm_timeout (void) 
+{
+  int64_t start;
+  int i, canceled;
+
+  callouts = malloc (sizeof *callouts * TIMEOUT_CNT);
+  if (callouts == NULL)
+    PANIC ("couldn't allocate callouts");
+  sema_init (&all_done, 0);
+
+  msg ("Adding %d timeouts.", TIMEOUT_CNT);
+  start = timer_ticks ();
+  remaining = TIMEOUT_CNT;
+  for (i = 0; i < TIMEOUT_CNT; i++) 
+    {
+      struct callout *c = &callouts[i];
+      int64_t delay = (i * 7919) % MAX_DELAY + 1;
+
+      c->due = timer_ticks () + delay;
+      c->runs = 0;
+      timeout_init (&c->timeout, callout_func, c);
+      timeout_add (&c->timeout, delay);
+    }
+
+  msg ("Canceling every third timeout.");
+  canceled = 0;
+  for (i = 0; i < TIMEOUT_CNT; i += 3)
+    if (timeout_cancel (&callouts[i].timeout)) 
+      {
+        enum intr_level old_level = intr_disable ();
+        remaining--;
+        intr_set_level (old_level);
+        canceled++;
+      }
+    else
+      fail ("timeout %d could not be canceled", i);
+  if (timeout_cancel (&callouts[0].timeout))
+    fail ("timeout 0 was canceled twice");
+
+  msg ("Waiting for the other timeouts to run.");
+  sema_down (&all_done);
+
+  /* Anything still pending would run now. */
+  timer_sleep (2);
+
+  for (i = 0; i < TIMEOUT_CNT; i++) 
+    {
+      int expected = i % 3 == 0 ? 0 : 1;
+      if (callouts[i].runs != expected)
+        fail ("timeout %d ran %d times", i, callouts[i].runs);
+    }
+  if (early)
+    fail ("a timeout ran before it was due");
+  if (out_of_order)
+    fail ("timeouts ran out of order");
+  if (intr_off)
+    fail ("a timeout ran with interrupts off");
+  msg ("%d timeouts canceled, the rest ran once each, in order.",
+       canceled);
+  msg ("benchmark: all timeouts done %lld ticks after the first was added.",
+       (long long) (timer_ticks () - start));
+
+  free (callouts);
+}
+
+static void
+callout_func (void *c_) 
+{
+  struct callout *c = c_;
+  enum intr_level old_level;
+
+  if (intr_get_level () != INTR_ON)
+    intr_off = true;
+  if (timer_ticks () < c->due)
+    early = true;
+  if (c->due < last_due)
+    out_of_order = true;
+  last_due = c->due;
+  c->runs++;
+
+  old_level = intr_disable ();
+  if (--remaining == 0)
+    sema_up (&all_done);
+  intr_set_level (old_level);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings vary from run to run, so they are not compared.
+@output = grep (!/\) benchmark: /, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-timeout) begin
+(alarm-timeout) Adding 3000 timeouts.
+(alarm-timeout) Canceling every third timeout.
+(alarm-timeout) Waiting for the other timeouts to run.
+(alarm-timeout) 1000 timeouts canceled, the rest ran once each, in order.
+(alarm-timeout) end
+EOF
+pass;
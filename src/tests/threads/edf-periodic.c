@@ -0,0 +1,139 @@
+/* Runs periodic tasks in the earliest-deadline-first class while
+   threads of the highest priority keep the CPU busy, and checks
+   that no task misses a deadline.
+
+   Each task is admitted with its (runtime, period, deadline), all
+   in timer ticks, and then runs a fixed number of jobs.  A job
+   spins until the next timer tick, which is always less than its
+   runtime, and then waits for its next period.  The tasks reserve
+   60% of the CPU between them, so one more task that wants 90%
+   must be refused by admission control.
+
+   The last task drops to the lowest priority once admitted, and its
+   first job overruns: it spins past its deadline.  It uses up its
+   runtime and falls back to that priority, where the load threads
+   starve it, so it runs again only if the scheduler releases its
+   next job on time.  Only the overrun job may miss its deadline. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define LOAD_CNT 4
+
+struct task 
+  {
+    int64_t runtime;
+    int64_t period;
+    int64_t deadline;
+    int job_cnt;
+    int overrun_cnt;
+    bool lowered;
+    unsigned misses;
+    struct semaphore admitted;
+    struct semaphore done;
+  };
+
+static struct task tasks[] = 
+  {
+    {.runtime = 2, .period = 10, .deadline = 10, .job_cnt = 30},
+    {.runtime = 3, .period = 20, .deadline = 15, .job_cnt = 15},
+    {.runtime = 5, .period = 50, .deadline = 50, .job_cnt = 6},
+    {.runtime = 2, .period = 20, .deadline = 20, .job_cnt = 10,
+     .overrun_cnt = 1, .lowered = true},
+  };
+
+#define TASK_CNT ((int) (sizeof tasks / sizeof *tasks))
+
+static bool stop;
+static struct semaphore load_done;
+
+static thread_func task_func;
+static thread_func load_func;
+
+void
+test_edf_periodic (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Stay ahead of the load threads until everything is started. */
+  thread_set_priority (PRI_MAX);
+
+  sema_init (&load_done, 0);
+  msg ("Starting %d threads of priority %d.", LOAD_CNT, PRI_MAX);
+  for (i = 0; i < LOAD_CNT; i++)
+    thread_create ("load", PRI_MAX, load_func, NULL);
+
+  for (i = 0; i < TASK_CNT; i++) 
+    {
+      struct task *t = &tasks[i];
+      char name[16];
+
+      sema_init (&t->admitted, 0);
+      sema_init (&t->done, 0);
+      snprintf (name, sizeof name, "edf %d", i);
+      thread_create (name, PRI_MAX, task_func, t);
+      sema_down (&t->admitted);
+      msg ("Task %d admitted with runtime %lld, period %lld, "
+           "deadline %lld.", i, (long long) t->runtime,
+           (long long) t->period, (long long) t->deadline);
+    }
+
+  if (thread_set_deadline (9, 10, 10))
+    fail ("admitted a task that wants 90%% of the CPU");
+  msg ("Task wanting 90%% of the CPU refused.");
+
+  for (i = 0; i < TASK_CNT; i++) 
+    {
+      struct task *t = &tasks[i];
+
+      sema_down (&t->done);
+      msg ("Task %d ran %d jobs with %u deadline misses.",
+           i, t->job_cnt, t->misses);
+    }
+
+  stop = true;
+  for (i = 0; i < LOAD_CNT; i++)
+    sema_down (&load_done);
+}
+
+static void
+task_func (void *t_) 
+{
+  struct task *t = t_;
+  int i;
+
+  if (!thread_set_deadline (t->runtime, t->period, t->deadline))
+    fail ("task with runtime %lld, period %lld refused",
+          (long long) t->runtime, (long long) t->period);
+  if (t->lowered)
+    thread_set_priority (PRI_MIN);
+  sema_up (&t->admitted);
+
+  for (i = 0; i < t->job_cnt; i++) 
+    {
+      int64_t start = timer_ticks ();
+      int64_t end = i < t->overrun_cnt ? start + t->period : start + 1;
+      while (timer_ticks () < end)
+        continue;
+      thread_wait_period ();
+    }
+
+  t->misses = thread_get_deadline_misses ();
+  thread_set_deadline (0, 0, 0);
+  sema_up (&t->done);
+}
+
+static void
+load_func (void *aux UNUSED) 
+{
+  while (!stop)
+    barrier ();
+  sema_up (&load_done);
+}
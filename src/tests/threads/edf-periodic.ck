@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-periodic) begin
+(edf-periodic) Starting 4 threads of priority 63.
+(edf-periodic) Task 0 admitted with runtime 2, period 10, deadline 10.
+(edf-periodic) Task 1 admitted with runtime 3, period 20, deadline 15.
+(edf-periodic) Task 2 admitted with runtime 5, period 50, deadline 50.
+(edf-periodic) Task 3 admitted with runtime 2, period 20, deadline 20.
+(edf-periodic) Task wanting 90% of the CPU refused.
+(edf-periodic) Task 0 ran 30 jobs with 0 deadline misses.
+(edf-periodic) Task 1 ran 15 jobs with 0 deadline misses.
+(edf-periodic) Task 2 ran 6 jobs with 0 deadline misses.
+(edf-periodic) Task 3 ran 10 jobs with 1 deadline misses.
+(edf-periodic) end
+EOF
+pass;
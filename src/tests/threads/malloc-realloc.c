@@ -0,0 +1,71 @@
+/* Checks that realloc() keeps a block where it is when the new size
+   still fits, gives back pages when a big block shrinks, and keeps
+   the contents of a block that grows step by step. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+
+#define GROW_STEP 700
+#define GROW_MAX 40000
+
+static void check_pattern (const char *, size_t);
+
+void
+test_malloc_realloc (void) 
+{
+  char *p, *q;
+  size_t size;
+
+  msg ("Resizing a small block within its size class.");
+  p = malloc (20);
+  memset (p, 'x', 20);
+  q = realloc (p, 30);
+  if (q != p)
+    fail ("20 to 30 bytes moved the block");
+  if (memcmp (q, "xxxxxxxxxxxxxxxxxxxx", 20))
+    fail ("20 to 30 bytes lost the contents");
+  q = realloc (q, 10);
+  if (q != p)
+    fail ("30 to 10 bytes moved the block");
+  free (q);
+
+  msg ("Shrinking a multi-page block.");
+  p = malloc (10000);
+  memset (p, 'y', 10000);
+  q = realloc (p, 5000);
+  if (q != p)
+    fail ("10000 to 5000 bytes moved the block");
+  free (q);
+
+  msg ("Growing a block %d bytes at a time to %d bytes.",
+       GROW_STEP, GROW_MAX);
+  p = NULL;
+  for (size = GROW_STEP; size <= GROW_MAX; size += GROW_STEP) 
+    {
+      size_t i;
+
+      p = realloc (p, size);
+      if (p == NULL)
+        fail ("realloc to %zu bytes failed", size);
+      check_pattern (p, size - GROW_STEP);
+      for (i = size - GROW_STEP; i < size; i++)
+        p[i] = i % 251;
+    }
+  check_pattern (p, size - GROW_STEP);
+  free (p);
+  msg ("Contents survived every resize.");
+}
+
+/* Checks that the first SIZE bytes of P hold the growth pattern. */
+static void
+check_pattern (const char *p, size_t size) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != (char) (i % 251))
+      fail ("byte %zu lost after resizing", i);
+}
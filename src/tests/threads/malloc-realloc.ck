@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-realloc) begin
+(malloc-realloc) Resizing a small block within its size class.
+(malloc-realloc) Shrinking a multi-page block.
+(malloc-realloc) Growing a block 700 bytes at a time to 40000 bytes.
+(malloc-realloc) Contents survived every resize.
+(malloc-realloc) end
+EOF
+pass;
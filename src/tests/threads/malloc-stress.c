@@ -0,0 +1,80 @@
+/* Allocates blocks of many sizes, across every malloc() size class
+   and into multi-page blocks, fills each with its own pattern, and
+   frees and reallocates them in a scrambled order.  Checks that no
+   block overwrites another. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+
+#define BLOCK_CNT 300
+#define ROUNDS 4
+
+static char *blocks[BLOCK_CNT];
+static size_t sizes[BLOCK_CNT];
+
+static void fill (int i);
+static void check (int i);
+
+void
+test_malloc_stress (void) 
+{
+  int round, i;
+
+  msg ("Allocating %d blocks of 1 to 5000 bytes.", BLOCK_CNT);
+  for (i = 0; i < BLOCK_CNT; i++)
+    fill (i);
+
+  msg ("Freeing and reallocating them %d times.", ROUNDS);
+  for (round = 0; round < ROUNDS; round++) 
+    {
+      for (i = 0; i < BLOCK_CNT; i++) 
+        {
+          int j = (i * 7 + round * 13) % BLOCK_CNT;
+          if (j % 2 == round % 2) 
+            {
+              check (j);
+              free (blocks[j]);
+              blocks[j] = NULL;
+            }
+        }
+      for (i = 0; i < BLOCK_CNT; i++)
+        if (blocks[i] == NULL)
+          fill (i);
+    }
+
+  msg ("Checking and freeing every block.");
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      check (i);
+      free (blocks[i]);
+    }
+}
+
+/* Allocates block I with a size that depends on I and fills it. */
+static void
+fill (int i) 
+{
+  static unsigned seed = 1;
+
+  seed = seed * 1103515245 + 12345;
+  sizes[i] = (seed >> 8) % (i % 10 == 0 ? 5000 : 700) + 1;
+  blocks[i] = malloc (sizes[i]);
+  if (blocks[i] == NULL)
+    fail ("allocating %zu bytes failed", sizes[i]);
+  memset (blocks[i], i, sizes[i]);
+}
+
+/* Checks that block I still holds its pattern. */
+static void
+check (int i) 
+{
+  size_t k;
+
+  for (k = 0; k < sizes[i]; k++)
+    if (blocks[i][k] != (char) i)
+      fail ("block %d of %zu bytes overwritten at byte %zu",
+            i, sizes[i], k);
+}
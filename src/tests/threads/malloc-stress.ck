@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-stress) begin
+(malloc-stress) Allocating 300 blocks of 1 to 5000 bytes.
+(malloc-stress) Freeing and reallocating them 4 times.
+(malloc-stress) Checking and freeing every block.
+(malloc-stress) end
+EOF
+pass;
@@ -0,0 +1,62 @@
+/* Allocates runs of kernel pages of many sizes, including sizes that
+   are not powers of two, fills each with its own pattern, and frees
+   them in a scrambled order.  Checks that no two runs overlap and
+   that freeing merges the pages back into blocks as large as the one
+   available before the test. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define RUN_CNT 64
+#define BIG_PAGES 64
+
+void
+test_palloc_buddy (void) 
+{
+  static uint8_t *runs[RUN_CNT];
+  static size_t sizes[RUN_CNT];
+  void *big;
+  int i, j;
+
+  msg ("Allocating a %d-page block.", BIG_PAGES);
+  big = palloc_get_multiple (0, BIG_PAGES);
+  if (big == NULL)
+    fail ("no %d-page block to begin with", BIG_PAGES);
+  palloc_free_multiple (big, BIG_PAGES);
+
+  msg ("Allocating %d runs of 1 to 7 pages.", RUN_CNT);
+  for (i = 0; i < RUN_CNT; i++) 
+    {
+      sizes[i] = i % 7 + 1;
+      runs[i] = palloc_get_multiple (0, sizes[i]);
+      if (runs[i] == NULL)
+        fail ("allocating run %d of %zu pages failed", i, sizes[i]);
+      memset (runs[i], i, sizes[i] * PGSIZE);
+    }
+
+  msg ("Checking the runs.");
+  for (i = 0; i < RUN_CNT; i++) 
+    {
+      size_t k;
+      for (k = 0; k < sizes[i] * PGSIZE; k++)
+        if (runs[i][k] != i)
+          fail ("run %d was overwritten at byte %zu", i, k);
+    }
+
+  msg ("Freeing the runs in a scrambled order.");
+  for (i = 0; i < RUN_CNT; i++) 
+    {
+      j = (i * 37) % RUN_CNT;
+      palloc_free_multiple (runs[j], sizes[j]);
+    }
+
+  msg ("Allocating a %d-page block again.", BIG_PAGES);
+  big = palloc_get_multiple (0, BIG_PAGES);
+  if (big == NULL)
+    fail ("freed pages were not merged back");
+  palloc_free_multiple (big, BIG_PAGES);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Allocating a 64-page block.
+(palloc-buddy) Allocating 64 runs of 1 to 7 pages.
+(palloc-buddy) Checking the runs.
+(palloc-buddy) Freeing the runs in a scrambled order.
+(palloc-buddy) Allocating a 64-page block again.
+(palloc-buddy) end
+EOF
+pass;
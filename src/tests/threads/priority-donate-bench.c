@@ -0,0 +1,184 @@
+/* Exercises priority donation in the two shapes that used to be
+   expensive, and times them.
+
+   First, the main thread drops to PRI_MIN, acquires lock 0, and
+   creates DEPTH donor threads with priorities PRI_MIN + 1 ...
+   PRI_MIN + DEPTH.  Donor i acquires lock i and then blocks on lock
+   i - 1, so each new donor's priority travels down the whole chain to
+   the main thread.  When the main thread releases lock 0 the chain
+   unwinds from the top, so the donors must finish in order of
+   decreasing priority.  This is repeated ROUNDS times.
+
+   Second, the main thread acquires HELD_CNT locks and compares how many
+   times per tick it can yield with and without them held.  Then a
+   single donor blocks on one of them, and the main thread checks that
+   it gets, and then loses, that donor's priority.
+
+   The timings vary from run to run, so they are reported on lines
+   starting with "benchmark:" and are not checked. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define DEPTH 32
+#define ROUNDS 20
+#define HELD_CNT 512
+
+/* Information about the donation chain. */
+struct chain 
+  {
+    struct lock locks[DEPTH + 1];       /* Lock i is held by donor i. */
+    int finish_order[DEPTH];            /* Donors, in order of finishing. */
+    int finished;                       /* Number of donors finished. */
+  };
+
+/* Information about a donor thread. */
+struct donor 
+  {
+    struct chain *chain;                /* Chain the donor belongs to. */
+    int index;                          /* Donor number. */
+    struct lock *own;                   /* Lock acquired first. */
+    struct lock *wanted;                /* Lock to block on. */
+  };
+
+static struct chain chain;
+static struct donor donors[DEPTH + 1];
+static struct lock held_locks[HELD_CNT];
+
+static thread_func donor_thread_func;
+static void build_chain (bool verbose);
+static long long yields_per_tick (void);
+
+void
+test_priority_donate_bench (void) 
+{
+  struct donor single;
+  long long idle_yields, busy_yields;
+  int64_t start;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MIN);
+
+  msg ("Building a %d-deep donation chain %d times.", DEPTH, ROUNDS);
+  start = timer_ticks ();
+  for (i = 0; i < ROUNDS; i++)
+    build_chain (i == 0);
+  msg ("benchmark: %d chains built and released in %lld ticks.",
+       ROUNDS, (long long) timer_elapsed (start));
+
+  msg ("Acquiring %d locks.", HELD_CNT);
+  idle_yields = yields_per_tick ();
+  for (i = 0; i < HELD_CNT; i++) 
+    {
+      lock_init (&held_locks[i]);
+      lock_acquire (&held_locks[i]);
+    }
+  busy_yields = yields_per_tick ();
+  msg ("benchmark: %lld yields/tick holding no locks, "
+       "%lld yields/tick holding %d locks.",
+       idle_yields, busy_yields, HELD_CNT);
+
+  /* The donor has no lock of its own to take first, so hand it one
+     that nobody else uses. */
+  lock_init (&chain.locks[0]);
+  single.chain = &chain;
+  single.index = 0;
+  single.own = &chain.locks[0];
+  single.wanted = &held_locks[HELD_CNT / 2];
+  chain.finished = 0;
+  thread_create ("single", PRI_MIN + 10, donor_thread_func, &single);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_MIN + 10, thread_get_priority ());
+
+  for (i = HELD_CNT - 1; i >= 0; i--)
+    lock_release (&held_locks[i]);
+  if (chain.finished != 1)
+    fail ("donor did not run after its lock was released");
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_MIN, thread_get_priority ());
+}
+
+/* Builds and unwinds the donation chain once, failing if the main
+   thread's priority or the donors' finishing order is wrong.  Reports
+   the main thread's priority if VERBOSE. */
+static void
+build_chain (bool verbose) 
+{
+  int i;
+
+  for (i = 0; i <= DEPTH; i++)
+    lock_init (&chain.locks[i]);
+  chain.finished = 0;
+
+  lock_acquire (&chain.locks[0]);
+  for (i = 1; i <= DEPTH; i++) 
+    {
+      struct donor *d = &donors[i];
+      char name[16];
+
+      d->chain = &chain;
+      d->index = i;
+      d->own = &chain.locks[i];
+      d->wanted = &chain.locks[i - 1];
+      snprintf (name, sizeof name, "donor %d", i);
+      thread_create (name, PRI_MIN + i, donor_thread_func, d);
+    }
+
+  if (verbose)
+    msg ("Main thread should have priority %d.  Actual priority: %d.",
+         PRI_MIN + DEPTH, thread_get_priority ());
+  else if (thread_get_priority () != PRI_MIN + DEPTH)
+    fail ("main thread has priority %d instead of %d",
+          thread_get_priority (), PRI_MIN + DEPTH);
+
+  lock_release (&chain.locks[0]);
+
+  if (chain.finished != DEPTH)
+    fail ("only %d of %d donors finished", chain.finished, DEPTH);
+  for (i = 0; i < DEPTH; i++)
+    if (chain.finish_order[i] != DEPTH - i)
+      fail ("donor %d finished in position %d", chain.finish_order[i], i);
+  if (verbose)
+    msg ("Donors finished in order of decreasing priority.");
+}
+
+/* Returns how many times per tick, averaged over several ticks, the
+   current thread can call thread_yield() with nothing else to run. */
+static long long
+yields_per_tick (void) 
+{
+  long long yields = 0;
+  int64_t start;
+
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+
+  start = timer_ticks ();
+  while (timer_elapsed (start) < 10) 
+    {
+      thread_yield ();
+      yields++;
+    }
+  return yields / 10;
+}
+
+/* Donor thread. */
+static void
+donor_thread_func (void *d_) 
+{
+  struct donor *d = d_;
+
+  lock_acquire (d->own);
+  lock_acquire (d->wanted);
+  lock_release (d->wanted);
+  lock_release (d->own);
+  d->chain->finish_order[d->chain->finished++] = d->index;
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings vary from run to run, so they are not compared.
+@output = grep (!/\) benchmark: /, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(priority-donate-bench) begin
+(priority-donate-bench) Building a 32-deep donation chain 20 times.
+(priority-donate-bench) Main thread should have priority 32.  Actual priority: 32.
+(priority-donate-bench) Donors finished in order of decreasing priority.
+(priority-donate-bench) Acquiring 512 locks.
+(priority-donate-bench) Main thread should have priority 10.  Actual priority: 10.
+(priority-donate-bench) Main thread should have priority 0.  Actual priority: 0.
+(priority-donate-bench) end
+EOF
+pass;
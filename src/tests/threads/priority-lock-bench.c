@@ -0,0 +1,129 @@
+/* Times uncontended lock acquire/release pairs, then checks that
+   releasing a lock to lower-priority waiters hands it over without
+   giving up the CPU.
+
+   First, the main thread acquires and releases one lock as many
+   times as it can in TICKS timer ticks, and does the same with
+   lock_try_acquire().
+
+   Second, the main thread holds the lock while WAITER_CNT threads of
+   lower priority queue up on it.  Releasing the lock must pass it
+   straight to the first waiter while the main thread keeps running.
+   The waiters then get the lock in the order they asked for it.
+
+   The timings vary from run to run, so they are reported on lines
+   starting with "benchmark:" and are not checked. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define TICKS 20
+#define WAITER_CNT 4
+
+static struct lock lock;
+static int got_lock[WAITER_CNT];        /* Waiters, in order served. */
+static int served;                      /* Number of waiters served. */
+
+static thread_func waiter_thread_func;
+static long long pairs_per_second (bool try);
+
+void
+test_priority_lock_bench (void) 
+{
+  int waiter_ids[WAITER_CNT];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&lock);
+  msg ("Timing uncontended acquire/release pairs.");
+  msg ("benchmark: %lld lock_acquire/lock_release pairs/s.",
+       pairs_per_second (false));
+  msg ("benchmark: %lld lock_try_acquire/lock_release pairs/s.",
+       pairs_per_second (true));
+  if (lock.holder != NULL)
+    fail ("lock still held after the last release");
+
+  msg ("Queueing %d lower-priority waiters.", WAITER_CNT);
+  lock_acquire (&lock);
+  for (i = 0; i < WAITER_CNT; i++) 
+    {
+      char name[16];
+
+      waiter_ids[i] = i;
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_DEFAULT - 1, waiter_thread_func,
+                     &waiter_ids[i]);
+    }
+
+  /* Sleeping lets the waiters run, one at a time, and block. */
+  timer_sleep (1);
+
+  lock_release (&lock);
+  msg ("Main thread kept running after releasing the lock.");
+  if (served != 0)
+    fail ("a waiter ran before the main thread gave up the CPU");
+  if (lock.holder == NULL || lock_held_by_current_thread (&lock))
+    fail ("lock was not handed to a waiter");
+
+  thread_set_priority (PRI_DEFAULT - 2);
+  if (served != WAITER_CNT)
+    fail ("only %d of %d waiters got the lock", served, WAITER_CNT);
+  for (i = 0; i < WAITER_CNT; i++)
+    if (got_lock[i] != i)
+      fail ("waiter %d got the lock in place of waiter %d",
+            got_lock[i], i);
+  msg ("Waiters got the lock in the order they asked for it.");
+}
+
+/* Returns the number of acquire/release pairs of LOCK per second, using
+   lock_try_acquire() if TRY is true, measured over TICKS ticks. */
+static long long
+pairs_per_second (bool try) 
+{
+  long long pairs = 0;
+  int64_t start;
+
+  /* Start on a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+
+  start = timer_ticks ();
+  while (timer_elapsed (start) < TICKS) 
+    {
+      int i;
+
+      for (i = 0; i < 100; i++) 
+        {
+          if (try)
+            {
+              if (!lock_try_acquire (&lock))
+                fail ("lock_try_acquire failed on a free lock");
+            }
+          else
+            lock_acquire (&lock);
+          lock_release (&lock);
+        }
+      pairs += 100;
+    }
+  return pairs * TIMER_FREQ / timer_elapsed (start);
+}
+
+static void
+waiter_thread_func (void *id_) 
+{
+  int *id = id_;
+
+  lock_acquire (&lock);
+  got_lock[served++] = *id;
+  lock_release (&lock);
+}
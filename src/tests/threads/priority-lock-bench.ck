@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings vary from run to run, so they are not compared.
+@output = grep (!/\) benchmark: /, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(priority-lock-bench) begin
+(priority-lock-bench) Timing uncontended acquire/release pairs.
+(priority-lock-bench) Queueing 4 lower-priority waiters.
+(priority-lock-bench) Main thread kept running after releasing the lock.
+(priority-lock-bench) Waiters got the lock in the order they asked for it.
+(priority-lock-bench) end
+EOF
+pass;
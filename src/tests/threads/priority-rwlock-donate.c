@@ -0,0 +1,54 @@
+/* The main thread holds a reader-writer lock for reading when a
+   writer of higher priority arrives and must wait for it.  The
+   writer donates its priority to the main thread, so a thread of
+   medium priority does not run until the main thread has stopped
+   reading and the writer is done. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static struct rwlock rwlock;
+
+static thread_func writer_thread_func;
+static thread_func medium_thread_func;
+
+void
+test_priority_rwlock_donate (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_read_acquire (&rwlock);
+  thread_create ("writer", PRI_DEFAULT + 10, writer_thread_func, NULL);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 10, thread_get_priority ());
+
+  thread_create ("medium", PRI_DEFAULT + 5, medium_thread_func, NULL);
+  msg ("Medium thread should not have run yet.");
+
+  rwlock_read_release (&rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  rwlock_write_acquire (&rwlock);
+  msg ("Writer acquired the rwlock.");
+  rwlock_write_release (&rwlock);
+  msg ("Writer finished.");
+}
+
+static void
+medium_thread_func (void *aux UNUSED) 
+{
+  msg ("Medium thread ran.");
+}
@@ -0,0 +1,94 @@
+/* Checks that readers share a reader-writer lock, that a waiting
+   writer keeps new readers out, and that a writer receives the
+   priority of the threads waiting behind it.
+
+   READER_CNT readers take the rwlock for reading and sleep while
+   holding it, so the main thread can see them all inside at once.
+   Then a writer blocks waiting for them to leave, and a late reader
+   of higher priority blocks behind the writer, donating to it.  When
+   the sleeping readers leave, the writer goes first, then the late
+   reader. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 4
+
+static struct rwlock rwlock;
+static int readers_inside;              /* Readers holding the rwlock. */
+static int max_readers_inside;          /* Most readers seen at once. */
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+static thread_func late_reader_thread_func;
+
+void
+test_priority_rwlock (void) 
+{
+  int ids[READER_CNT];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+
+      ids[i] = i;
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT + 1, reader_thread_func, &ids[i]);
+    }
+  msg ("%d readers hold the rwlock at once.", max_readers_inside);
+
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, NULL);
+  thread_create ("late reader", PRI_DEFAULT + 3,
+                 late_reader_thread_func, NULL);
+  msg ("Writer and late reader are waiting.");
+
+  timer_sleep (20);
+  msg ("Main thread finished.");
+}
+
+static void
+reader_thread_func (void *id_) 
+{
+  int *id = id_;
+
+  rwlock_read_acquire (&rwlock);
+  if (++readers_inside > max_readers_inside)
+    max_readers_inside = readers_inside;
+  msg ("Reader %d acquired the rwlock.", *id);
+  timer_sleep (10);
+  readers_inside--;
+  msg ("Reader %d releasing the rwlock.", *id);
+  rwlock_read_release (&rwlock);
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  rwlock_write_acquire (&rwlock);
+  if (readers_inside != 0)
+    fail ("writer got in with %d readers inside", readers_inside);
+  msg ("Writer acquired the rwlock with priority %d.",
+       thread_get_priority ());
+  rwlock_write_release (&rwlock);
+  msg ("Writer finished with priority %d.", thread_get_priority ());
+}
+
+static void
+late_reader_thread_func (void *aux UNUSED) 
+{
+  rwlock_read_acquire (&rwlock);
+  msg ("Late reader acquired the rwlock.");
+  rwlock_read_release (&rwlock);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock) begin
+(priority-rwlock) Reader 0 acquired the rwlock.
+(priority-rwlock) Reader 1 acquired the rwlock.
+(priority-rwlock) Reader 2 acquired the rwlock.
+(priority-rwlock) Reader 3 acquired the rwlock.
+(priority-rwlock) 4 readers hold the rwlock at once.
+(priority-rwlock) Writer and late reader are waiting.
+(priority-rwlock) Reader 0 releasing the rwlock.
+(priority-rwlock) Reader 1 releasing the rwlock.
+(priority-rwlock) Reader 2 releasing the rwlock.
+(priority-rwlock) Reader 3 releasing the rwlock.
+(priority-rwlock) Writer acquired the rwlock with priority 34.
+(priority-rwlock) Late reader acquired the rwlock.
+(priority-rwlock) Writer finished with priority 33.
+(priority-rwlock) Main thread finished.
+(priority-rwlock) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Measures how many short-lived threads can be created, run, and
+   destroyed per second.
+
+   The main thread repeatedly creates a thread of higher priority,
+   which preempts it, counts itself, and exits at once, so each
+   iteration covers a whole thread lifetime.  This goes on for TICKS
+   timer ticks.  The count is checked, so a lost or extra thread is
+   caught.
+
+   The timings vary from run to run, so they are reported on lines
+   starting with "benchmark:" and are not checked. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define TICKS 50
+
+static int run_cnt;                     /* Threads that have run. */
+
+static thread_func counter_thread_func;
+
+void
+test_priority_spawn_bench (void) 
+{
+  int spawn_cnt = 0;
+  int64_t start, elapsed;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  msg ("Spawning threads for %d ticks.", TICKS);
+  start = timer_ticks ();
+  while ((elapsed = timer_elapsed (start)) < TICKS) 
+    {
+      if (thread_create ("counter", PRI_DEFAULT + 1,
+                         counter_thread_func, NULL) == TID_ERROR)
+        fail ("thread_create failed after %d threads", spawn_cnt);
+      spawn_cnt++;
+    }
+
+  if (run_cnt != spawn_cnt)
+    fail ("%d threads created but %d ran", spawn_cnt, run_cnt);
+  msg ("Every thread created ran before the next was created.");
+  msg ("benchmark: %lld threads/s (%d threads in %lld ticks).",
+       (long long) spawn_cnt * TIMER_FREQ / elapsed, spawn_cnt,
+       (long long) elapsed);
+}
+
+static void
+counter_thread_func (void *aux UNUSED) 
+{
+  run_cnt++;
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings vary from run to run, so they are not compared.
+@output = grep (!/\) benchmark: /, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(priority-spawn-bench) begin
+(priority-spawn-bench) Spawning threads for 50 ticks.
+(priority-spawn-bench) Every thread created ran before the next was created.
+(priority-spawn-bench) end
+EOF
+pass;
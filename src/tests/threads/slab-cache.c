@@ -0,0 +1,82 @@
+/* Creates an object cache with a constructor, allocates enough
+   objects to span several slabs, and checks that they are distinct,
+   aligned and constructed.  Then frees them all and checks that
+   reused objects keep the state they were freed in. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+
+#define OBJ_CNT 200
+
+struct object 
+  {
+    int magic;                  /* Set by the constructor. */
+    int owner;                  /* Index of the allocation. */
+    char pad[300];              /* Makes a few objects per page. */
+  };
+
+#define OBJECT_MAGIC 0x0b1ec7
+
+static void object_ctor (void *);
+
+void
+test_slab_cache (void) 
+{
+  static struct object *objs[OBJ_CNT];
+  struct kmem_cache *cache;
+  int i, j;
+
+  cache = kmem_cache_create ("test", sizeof (struct object), object_ctor);
+  if (cache == NULL)
+    fail ("kmem_cache_create failed");
+
+  msg ("Allocating %d objects.", OBJ_CNT);
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("allocating object %d failed", i);
+      if ((uintptr_t) objs[i] % 8 != 0)
+        fail ("object %d at %p is misaligned", i, objs[i]);
+      if (objs[i]->magic != OBJECT_MAGIC)
+        fail ("object %d was not constructed", i);
+      objs[i]->owner = i;
+      memset (objs[i]->pad, i, sizeof objs[i]->pad);
+    }
+
+  msg ("Checking that no two objects overlap.");
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      if (objs[i]->owner != i)
+        fail ("object %d was overwritten", i);
+      for (j = 0; j < (int) sizeof objs[i]->pad; j++)
+        if (objs[i]->pad[j] != (char) i)
+          fail ("object %d was overwritten at byte %d", i, j);
+    }
+
+  msg ("Freeing and reallocating the objects.");
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("reallocating object %d failed", i);
+      if (objs[i]->magic != OBJECT_MAGIC)
+        fail ("object %d lost its constructed state", i);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  kmem_cache_reclaim (cache);
+  msg ("All objects kept their constructed state.");
+}
+
+static void
+object_ctor (void *obj_) 
+{
+  struct object *obj = obj_;
+  obj->magic = OBJECT_MAGIC;
+}
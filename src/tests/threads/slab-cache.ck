@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) Allocating 200 objects.
+(slab-cache) Checking that no two objects overlap.
+(slab-cache) Freeing and reallocating the objects.
+(slab-cache) All objects kept their constructed state.
+(slab-cache) end
+EOF
+pass;
@@ -0,0 +1,110 @@
+/* Measures the correctness of the stride scheduler.
+
+   The "fair" tests run either 2 or 20 threads, all with the
+   default number of tickets.  The threads should all receive
+   approximately the same number of ticks.  Each test runs for 30
+   seconds, so the ticks should also sum to approximately 30 *
+   100 == 3000 ticks.
+
+   The stride-ratio test runs 4 threads with 100, 200, 300, and
+   400 tickets, which should receive 300, 600, 900, and 1,200
+   ticks, respectively, over 30 seconds. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_stride_fair (int thread_cnt, int tickets_min,
+                              int tickets_step);
+
+void
+test_stride_fair_2 (void) 
+{
+  test_stride_fair (2, TICKETS_DEFAULT, 0);
+}
+
+void
+test_stride_fair_20 (void) 
+{
+  test_stride_fair (20, TICKETS_DEFAULT, 0);
+}
+
+void
+test_stride_ratio (void) 
+{
+  test_stride_fair (4, 100, 100);
+}
+
+#define MAX_THREAD_CNT 20
+
+struct thread_info 
+  {
+    int64_t start_time;
+    int tick_count;
+    int tickets;
+  };
+
+static void load_thread (void *aux);
+
+static void
+test_stride_fair (int thread_cnt, int tickets_min, int tickets_step)
+{
+  struct thread_info info[MAX_THREAD_CNT];
+  int64_t start_time;
+  int tickets;
+  int i;
+
+  ASSERT (thread_stride);
+  ASSERT (thread_cnt <= MAX_THREAD_CNT);
+  ASSERT (tickets_min >= TICKETS_MIN);
+  ASSERT (tickets_step >= 0);
+  ASSERT (tickets_min + tickets_step * (thread_cnt - 1) <= TICKETS_MAX);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", thread_cnt);
+  tickets = tickets_min;
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->tick_count = 0;
+      ti->tickets = tickets;
+
+      snprintf(name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+
+      tickets += tickets_step;
+    }
+  msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
+
+  msg ("Sleeping 40 seconds to let threads run, please wait...");
+  timer_sleep (40 * TIMER_FREQ);
+  
+  for (i = 0; i < thread_cnt; i++)
+    msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+}
+
+static void
+load_thread (void *ti_) 
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 5 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 30 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  thread_set_tickets (ti->tickets);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
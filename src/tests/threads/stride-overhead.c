@@ -0,0 +1,79 @@
+/* Measures the cost of a stride scheduler decision with many
+   threads ready to run.
+
+   THREAD_CNT threads with different numbers of tickets yield to
+   each other as fast as they can for TICKS timer ticks, so that
+   nearly all the time goes to picking the next thread.  Every
+   thread must get to run at least once.
+
+   The timings vary from run to run, so they are reported on lines
+   starting with "benchmark:" and are not checked. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 32
+#define TICKS 400
+
+struct yielder 
+  {
+    int64_t start_time;
+    int tickets;
+    long long yield_cnt;
+  };
+
+static thread_func yielder_func;
+
+void
+test_stride_overhead (void) 
+{
+  struct yielder yielders[THREAD_CNT];
+  long long total = 0;
+  int64_t start_time;
+  int i;
+
+  ASSERT (thread_stride);
+
+  msg ("Starting %d threads yielding for %d ticks.", THREAD_CNT, TICKS);
+  start_time = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct yielder *y = &yielders[i];
+      char name[16];
+
+      y->start_time = start_time;
+      y->tickets = TICKETS_DEFAULT + i * 10;
+      y->yield_cnt = 0;
+
+      snprintf (name, sizeof name, "yielder %d", i);
+      thread_create (name, PRI_DEFAULT, yielder_func, y);
+    }
+
+  timer_sleep (TICKS + 2 * TIMER_FREQ);
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      if (yielders[i].yield_cnt == 0)
+        fail ("thread %d never ran", i);
+      total += yielders[i].yield_cnt;
+    }
+  msg ("Every thread ran.");
+  msg ("benchmark: %lld yields/s (%lld yields among %d threads).",
+       total * TIMER_FREQ / TICKS, total, THREAD_CNT);
+}
+
+static void
+yielder_func (void *y_) 
+{
+  struct yielder *y = y_;
+
+  thread_set_tickets (y->tickets);
+  while (timer_elapsed (y->start_time) < TICKS) 
+    {
+      thread_yield ();
+      y->yield_cnt++;
+    }
+}
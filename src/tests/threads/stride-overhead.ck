@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings vary from run to run, so they are not compared.
+@output = grep (!/\) benchmark: /, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(stride-overhead) begin
+(stride-overhead) Starting 32 threads yielding for 400 ticks.
+(stride-overhead) Every thread ran.
+(stride-overhead) end
+EOF
+pass;
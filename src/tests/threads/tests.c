@@ -13,10 +13,14 @@ static const struct test tests[] =
   {
     {"alarm-single", test_alarm_single},
     {"alarm-multiple", test_alarm_multiple},
+    {"alarm-tickless", test_alarm_tickless},
     {"alarm-simultaneous", test_alarm_simultaneous},
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-stress", test_alarm_stress},
+    {"alarm-hrsleep", test_alarm_hrsleep},
+    {"alarm-timeout", test_alarm_timeout},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,6 +29,17 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-bench", test_priority_donate_bench},
+    {"priority-lock-bench", test_priority_lock_bench},
+    {"priority-rwlock", test_priority_rwlock},
+    {"priority-rwlock-donate", test_priority_rwlock_donate},
+    {"priority-spawn-bench", test_priority_spawn_bench},
+    {"edf-periodic", test_edf_periodic},
+    {"thread-wait", test_thread_wait},
+    {"palloc-buddy", test_palloc_buddy},
+    {"slab-cache", test_slab_cache},
+    {"malloc-stress", test_malloc_stress},
+    {"malloc-realloc", test_malloc_realloc},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +53,10 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"stride-fair-2", test_stride_fair_2},
+    {"stride-fair-20", test_stride_fair_20},
+    {"stride-ratio", test_stride_ratio},
+    {"stride-overhead", test_stride_overhead},
   };
 
 static const char *test_name;
@@ -7,10 +7,14 @@ typedef void test_func (void);
 
 extern test_func test_alarm_single;
 extern test_func test_alarm_multiple;
+extern test_func test_alarm_tickless;
 extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_stress;
+extern test_func test_alarm_hrsleep;
+extern test_func test_alarm_timeout;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,6 +23,17 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_bench;
+extern test_func test_priority_lock_bench;
+extern test_func test_priority_rwlock;
+extern test_func test_priority_rwlock_donate;
+extern test_func test_priority_spawn_bench;
+extern test_func test_edf_periodic;
+extern test_func test_thread_wait;
+extern test_func test_palloc_buddy;
+extern test_func test_slab_cache;
+extern test_func test_malloc_stress;
+extern test_func test_malloc_realloc;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
@@ -32,6 +47,10 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_stride_fair_2;
+extern test_func test_stride_fair_20;
+extern test_func test_stride_ratio;
+extern test_func test_stride_overhead;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,82 @@
+/* Creates a batch of children, finds each of them by tid while it
+   is alive, then waits for them in reverse order and checks their
+   exit statuses.  Also checks that a status can be collected only
+   once and that only a thread's parent can collect it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define CHILD_CNT 50
+
+static struct semaphore go;
+
+static thread_func child_func;
+
+void
+test_thread_wait (void) 
+{
+  tid_t tids[CHILD_CNT];
+  enum intr_level old_level;
+  int i;
+
+  sema_init (&go, 0);
+
+  msg ("Creating %d children.", CHILD_CNT);
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "child %d", i);
+      tids[i] = thread_create (name, PRI_DEFAULT, child_func,
+                               (void *) i);
+      if (tids[i] == TID_ERROR)
+        fail ("thread_create failed for child %d", i);
+    }
+
+  msg ("Looking up each child by tid.");
+  old_level = intr_disable ();
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      struct thread *t = thread_lookup (tids[i]);
+      if (t == NULL || t->tid != tids[i])
+        fail ("child %d not found by tid", i);
+    }
+  if (thread_lookup (tids[CHILD_CNT - 1] + 1000) != NULL)
+    fail ("found a thread for a tid never handed out");
+  intr_set_level (old_level);
+
+  if (thread_wait (thread_tid ()) != -1)
+    fail ("waited for a thread that is not a child");
+
+  msg ("Waiting for children in reverse order.");
+  for (i = 0; i < CHILD_CNT; i++)
+    sema_up (&go);
+  for (i = CHILD_CNT - 1; i >= 0; i--) 
+    {
+      int status = thread_wait (tids[i]);
+      if (status != i * 3)
+        fail ("child %d exited with %d, expected %d", i, status, i * 3);
+      if (thread_wait (tids[i]) != -1)
+        fail ("collected child %d's status twice", i);
+    }
+
+  old_level = intr_disable ();
+  for (i = 0; i < CHILD_CNT; i++)
+    if (thread_lookup (tids[i]) != NULL)
+      fail ("child %d still found after exiting", i);
+  intr_set_level (old_level);
+
+  msg ("Every child exited with its own status.");
+}
+
+static void
+child_func (void *i_) 
+{
+  int i = (int) i_;
+
+  sema_down (&go);
+  thread_set_exit_status (i * 3);
+}
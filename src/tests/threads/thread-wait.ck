@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-wait) begin
+(thread-wait) Creating 50 children.
+(thread-wait) Looking up each child by tid.
+(thread-wait) Waiting for children in reverse order.
+(thread-wait) Every child exited with its own status.
+(thread-wait) end
+EOF
+pass;
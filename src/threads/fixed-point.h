@@ -4,11 +4,41 @@
 #include <stdint.h>
 typedef int fixed_F; /* F decimal points. */
 
-fixed_F fixed_point(int n);
-fixed_F fixed_frac(int p, int q);
-fixed_F fixed_mult(fixed_F a, fixed_F b); 
-fixed_F fixed_div(fixed_F p, fixed_F q);
-int fixed_to_int(fixed_F x);
+#define FIXED_FRAC_BITS 14 /* Number of fractional digits in binary. */
+#define FIXED_ONE (1 << FIXED_FRAC_BITS)
 
+/* These are called from the timer interrupt, so they are kept inline.
+   Only fixed_mult() and fixed_div() need 64-bit intermediates. */
+
+static inline fixed_F fixed_point(int n) {
+    return (fixed_F) n * FIXED_ONE;
+}
+
+static inline fixed_F fixed_frac(int p, int q) { 
+    return p * FIXED_ONE / q;
+}
+
+static inline fixed_F fixed_mult(fixed_F a, fixed_F b) { 
+    return (fixed_F) (((int64_t) a) * b / FIXED_ONE);
+}
+
+static inline fixed_F fixed_div(fixed_F p, fixed_F q) { 
+    return (fixed_F) (((int64_t) p) * FIXED_ONE / q);
+}
+
+static inline fixed_F fixed_mult_int(fixed_F a, int n) {
+    return a * n;
+}
+
+static inline fixed_F fixed_div_int(fixed_F a, int n) {
+    return a / n;
+}
+
+static inline int fixed_to_int(fixed_F x) {
+    if (x >= 0)
+        return (x + FIXED_ONE / 2) / FIXED_ONE;
+    else
+        return (x - FIXED_ONE / 2) / FIXED_ONE;
+}
 
 #endif /* threads/fixed-point.h */
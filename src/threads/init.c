@@ -13,6 +13,7 @@
 #include "devices/serial.h"
 #include "devices/shutdown.h"
 #include "devices/timer.h"
+#include "devices/tsc.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
 #include "threads/interrupt.h"
@@ -21,7 +22,9 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 #ifdef USERPROG
 
@@ -113,6 +116,7 @@ int main(void) {
 
     /* Initialize interrupt handlers. */
     intr_init();
+    workqueue_init();
     timer_init();
     kbd_init();
     input_init();
@@ -123,8 +127,10 @@ int main(void) {
 
     /* Start thread scheduler and enable interrupts. */
     thread_start();
+    workqueue_start();
     serial_init_queue();
     timer_calibrate();
+    tsc_calibrate();
 
 #ifdef FILESYS
     /* Initialize file system. */
@@ -250,6 +256,12 @@ static char ** parse_options(char **argv) {
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-stride"))
+            thread_stride = true;
+        else if (!strcmp(name, "-tickless"))
+            timer_tickless = true;
+        else if (!strcmp(name, "-lockprof"))
+            lock_profiling = true;
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -258,6 +270,9 @@ static char ** parse_options(char **argv) {
             PANIC("unknown option `%s' (use -h for help)", name);
     }
 
+    if (thread_mlfqs && thread_stride)
+        PANIC("-mlfqs and -stride cannot be used together");
+
     /* Initialize the random number generator based on the system
        time.  This has no effect if an "-rs" option was specified.
 
@@ -367,6 +382,9 @@ static void usage(void) {
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
            "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+           "  -stride            Use proportional-share stride scheduler.\n"
+           "  -tickless          Stop the timer tick while the CPU is idle.\n"
+           "  -lockprof          Profile contention on the busiest locks.\n"
 #ifdef USERPROG
            "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
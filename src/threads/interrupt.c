@@ -322,6 +322,13 @@ void intr_handler(struct intr_frame *frame) {
 
         in_external_intr = true;
         yield_on_return = false;
+
+        /* A device interrupt ends a tickless idle period.  Catch up on
+           the skipped ticks now, while the idle thread is still the
+           running thread, before the handler can ready a thread that
+           preempts it.  The timer interrupt does this itself. */
+        if (frame->vec_no != 0x20)
+            timer_idle_exit();
     }
 
     /* Invoke the interrupt's handler. */
@@ -2,28 +2,33 @@
 
    A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
-
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   The size of each request, in bytes, is rounded up to a size class
+   and assigned to the "descriptor" that manages blocks of that size.
+   Classes go up in 16-byte steps to 128 bytes and in steps of about
+   12.5% after that, and each is widened to use all of the space that
+   its number of blocks per page leaves, so that little of a request
+   or a page is wasted.
+
+   Blocks are carved out of pages, called "arenas", obtained from the
+   page allocator.  Each arena keeps its own list of free blocks, and
+   a descriptor keeps the arenas that have both free and used blocks
+   on lists by how full they are.  A request is served from the
+   fullest such arena, which lets the emptier ones drain.  If there is
+   none, a new arena is obtained from the page allocator (if none is
+   available, malloc() returns a null pointer).  Blocks of a new arena
+   are handed out in order before any of its free list is used, so
+   setting up an arena does not touch its blocks.
+
+   When we free a block, we add it to its arena's free list.  If the
+   arena then has no in-use blocks, we give it back to the page
+   allocator, which takes constant time since no other list refers to
+   its blocks.
+
+   We can't handle blocks bigger than half a page using this scheme,
+   because they're too big to fit two in a page with a descriptor.  We
+   handle those by allocating contiguous pages with the page allocator
+   and sticking the allocation size at the beginning of the allocated
+   block's arena header. */
 
 #include "threads/malloc.h"
 #include <debug.h>
@@ -37,12 +42,18 @@
 #include "threads/vaddr.h"
 
 
+/*! Number of lists a descriptor sorts its partly used arenas into by
+    how many free blocks they have. */
+#define FULLNESS_LISTS 4
+
 /*! Descriptor. */
 struct desc {
     size_t block_size;          /*!< Size of each element in bytes. */
     size_t blocks_per_arena;    /*!< Number of blocks in an arena. */
-    struct list free_list;      /*!< List of free blocks. */
+    struct list partial[FULLNESS_LISTS]; /*!< Arenas with both free and
+                                     used blocks, fullest first. */
     struct lock lock;           /*!< Lock. */
+    struct lock_profile profile; /*!< Contention on LOCK. */
 };
 
 /*! Magic number for detecting arena corruption. */
@@ -53,31 +64,64 @@ struct arena {
     unsigned magic;             /*!< Always set to ARENA_MAGIC. */
     struct desc *desc;          /*!< Owning descriptor, null for big block. */
     size_t free_cnt;            /*!< Free blocks; pages in big block. */
+    struct list_elem elem;      /*!< In a desc's partial list. */
+    struct block *free_list;    /*!< Free blocks once used. */
+    size_t unused_idx;          /*!< First block never handed out. */
 };
 
 /*! Free block. */
 struct block {
-    struct list_elem free_elem; /*!< Free list element. */
+    struct block *next;         /*!< Next in arena's free list. */
 };
 
+/*! Largest block a descriptor handles. */
+#define DESC_MAX_SIZE ((PGSIZE - sizeof (struct arena)) / 2)
+
 /*! Our set of descriptors. */
-static struct desc descs[10];   /*!< Descriptors. */
+static struct desc descs[40];   /*!< Descriptors. */
 static size_t desc_cnt;         /*!< Number of descriptors. */
 
+/*! Smallest descriptor for each request size, indexed by the size
+    divided by 16, rounded up. */
+static struct desc *size_desc[DIV_ROUND_UP(DESC_MAX_SIZE, 16) + 1];
+
 static struct arena *block_to_arena(struct block *);
 static struct block *arena_to_block(struct arena *, size_t idx);
+static struct list *arena_partial_list(struct arena *);
 
 /*! Initializes the malloc() descriptors. */
 void malloc_init(void) {
-    size_t block_size;
+    const size_t space = PGSIZE - sizeof (struct arena);
+    size_t size, i;
+    char name[16];
 
-    for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+    for (size = 16; size <= DESC_MAX_SIZE; ) {
         struct desc *d = &descs[desc_cnt++];
+        size_t blocks = space / size;
+        int j;
+
+        /* Widen the class into whatever space its blocks leave. */
         ASSERT(desc_cnt <= sizeof descs / sizeof *descs);
-        d->block_size = block_size;
-        d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-        list_init(&d->free_list);
+        d->block_size = ROUND_DOWN(space / blocks, 16);
+        if (d->block_size > DESC_MAX_SIZE)
+            d->block_size = ROUND_DOWN(DESC_MAX_SIZE, 16);
+        d->blocks_per_arena = space / d->block_size;
+        for (j = 0; j < FULLNESS_LISTS; j++)
+            list_init(&d->partial[j]);
         lock_init(&d->lock);
+        snprintf(name, sizeof name, "malloc %zu", d->block_size);
+        lock_profile(&d->lock, &d->profile, name);
+
+        size = d->block_size < 128 ? d->block_size + 16
+               : ROUND_UP(d->block_size + d->block_size / 8, 16);
+    }
+
+    /* Map each request size to its descriptor. */
+    for (i = 0; i < sizeof size_desc / sizeof *size_desc; i++) {
+        struct desc *d = descs;
+        while (d < descs + desc_cnt && d->block_size < i * 16)
+            d++;
+        size_desc[i] = d < descs + desc_cnt ? d : NULL;
     }
 }
 
@@ -87,6 +131,7 @@ void * malloc(size_t size) {
     struct desc *d;
     struct block *b;
     struct arena *a;
+    int i;
 
     /* A null pointer satisfies a request for 0 bytes. */
     if (size == 0)
@@ -94,12 +139,8 @@ void * malloc(size_t size) {
 
     /* Find the smallest descriptor that satisfies a SIZE-byte
        request. */
-    for (d = descs; d < descs + desc_cnt; d++) {
-        if (d->block_size >= size)
-            break;
-    }
-
-    if (d == descs + desc_cnt) {
+    d = size <= DESC_MAX_SIZE ? size_desc[DIV_ROUND_UP(size, 16)] : NULL;
+    if (d == NULL) {
         /* SIZE is too big for any descriptor.
            Allocate enough pages to hold SIZE plus an arena. */
         size_t page_cnt = DIV_ROUND_UP(size + sizeof *a, PGSIZE);
@@ -117,10 +158,15 @@ void * malloc(size_t size) {
 
     lock_acquire(&d->lock);
 
-    /* If the free list is empty, create a new arena. */
-    if (list_empty (&d->free_list)) {
-        size_t i;
-
+    /* Take the fullest arena with a free block, or else a new one. */
+    a = NULL;
+    for (i = 0; i < FULLNESS_LISTS; i++)
+        if (!list_empty(&d->partial[i])) {
+            a = list_entry(list_pop_front(&d->partial[i]),
+                           struct arena, elem);
+            break;
+        }
+    if (a == NULL) {
         /* Allocate a page. */
         a = palloc_get_page(0);
         if (a == NULL) {
@@ -128,20 +174,24 @@ void * malloc(size_t size) {
             return NULL; 
         }
 
-        /* Initialize arena and add its blocks to the free list. */
+        /* Initialize arena.  Its blocks are handed out in order until
+           the first of them is freed. */
         a->magic = ARENA_MAGIC;
         a->desc = d;
         a->free_cnt = d->blocks_per_arena;
-        for (i = 0; i < d->blocks_per_arena; i++) {
-            struct block *b = arena_to_block(a, i);
-            list_push_back(&d->free_list, &b->free_elem);
-        }
+        a->free_list = NULL;
+        a->unused_idx = 0;
     }
 
-    /* Get a block from free list and return it. */
-    b = list_entry(list_pop_front (&d->free_list), struct block, free_elem);
-    a = block_to_arena(b);
-    a->free_cnt--;
+    /* Get a block from the arena and return it. */
+    if (a->free_list != NULL) {
+        b = a->free_list;
+        a->free_list = b->next;
+    }
+    else
+        b = arena_to_block(a, a->unused_idx++);
+    if (--a->free_cnt > 0)
+        list_push_front(arena_partial_list(a), &a->elem);
     lock_release(&d->lock);
     return b;
 }
@@ -174,10 +224,37 @@ static size_t block_size(void *block) {
     return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs(block);
 }
 
+/*! Tries to resize OLD_BLOCK, which is not null, to NEW_SIZE bytes
+    without moving it.  Returns true if successful. */
+static bool resize_in_place(void *old_block, size_t new_size) {
+    struct arena *a = block_to_arena(old_block);
+    size_t page_cnt;
+
+    /* A block of a size class fits anything up to that size. */
+    if (a->desc != NULL)
+        return new_size <= a->desc->block_size;
+
+    /* A big block stays one as long as it is too big for any
+       descriptor.  It gives back pages it no longer needs, and takes
+       more from the free pages after it if they are all free. */
+    if (new_size <= DESC_MAX_SIZE)
+        return false;
+    page_cnt = DIV_ROUND_UP(new_size + sizeof *a, PGSIZE);
+    if (page_cnt < a->free_cnt)
+        palloc_free_multiple((uint8_t *) a + page_cnt * PGSIZE,
+                             a->free_cnt - page_cnt);
+    else if (page_cnt > a->free_cnt
+             && !palloc_extend(a, a->free_cnt, page_cnt))
+        return false;
+    a->free_cnt = page_cnt;
+    return true;
+}
+
 /*! Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
     moving it in the process.
     If successful, returns the new block; on failure, returns a
-    null pointer.
+    null pointer.  The block is moved, and its contents copied, only
+    if it cannot be resized where it is.
 
     A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
 
@@ -187,9 +264,13 @@ void * realloc(void *old_block, size_t new_size) {
         free(old_block);
         return NULL;
     }
+    else if (old_block == NULL)
+        return malloc(new_size);
+    else if (resize_in_place(old_block, new_size))
+        return old_block;
     else {
         void *new_block = malloc(new_size);
-        if (old_block != NULL && new_block != NULL) {
+        if (new_block != NULL) {
             size_t old_size = block_size (old_block);
             size_t min_size = new_size < old_size ? new_size : old_size;
             memcpy(new_block, old_block, min_size);
@@ -217,20 +298,21 @@ void free(void *p) {
 
             lock_acquire(&d->lock);
 
-            /* Add block to free list. */
-            list_push_front(&d->free_list, &b->free_elem);
+            /* Add block to its arena's free list, taking the arena off
+               the partial list it was on, if any. */
+            if (a->free_cnt > 0)
+                list_remove(&a->elem);
+            b->next = a->free_list;
+            a->free_list = b;
 
-            /* If the arena is now entirely unused, free it. */
+            /* If the arena is now entirely unused, free it.  Otherwise
+               file it by its new fullness. */
             if (++a->free_cnt >= d->blocks_per_arena) {
-                size_t i;
-
                 ASSERT(a->free_cnt == d->blocks_per_arena);
-                for (i = 0; i < d->blocks_per_arena; i++) {
-                    struct block *b = arena_to_block(a, i);
-                    list_remove(&b->free_elem);
-                }
                 palloc_free_page(a);
             }
+            else
+                list_push_front(arena_partial_list(a), &a->elem);
 
             lock_release(&d->lock);
         }
@@ -241,7 +323,16 @@ void free(void *p) {
         }
     }
 }
-
+
+/*! Returns the partial list of its descriptor that arena A, which has
+    both free and used blocks, belongs on. */
+static struct list * arena_partial_list(struct arena *a) {
+    struct desc *d = a->desc;
+
+    ASSERT(a->free_cnt > 0 && a->free_cnt < d->blocks_per_arena);
+    return &d->partial[a->free_cnt * FULLNESS_LISTS / d->blocks_per_arena];
+}
+
 /*! Returns the arena that block B is inside. */
 static struct arena * block_to_arena(struct block *b) {
     struct arena *a = pg_round_down(b);
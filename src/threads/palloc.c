@@ -10,34 +10,118 @@
 
    By default, half of system RAM is given to the kernel pool and half to the
    user pool.  That should be huge overkill for the kernel pool, but that's
-   just fine for demonstration purposes. */
+   just fine for demonstration purposes.
+
+   Within a pool, free pages are managed by a binary buddy allocator.
+   Every free block is 2**ORDER pages long and starts at a page index
+   that is a multiple of its length.  An allocation takes the smallest
+   free block that fits, splitting larger blocks in half as needed, and
+   gives back the pages it does not use.  A freed block is merged with
+   its buddy, the other half of the next larger block, whenever that is
+   free too.  Both take O(log n) time in the size of the pool.
+
+   Single pages, which are nearly all requests, are served first from
+   a per-CPU magazine: a small stack of free pages that is refilled
+   from and drained to the buddy allocator a batch at a time, so that
+   most single-page requests take neither the pool lock nor a trip
+   through the free lists.
+
+   The idle thread also keeps a small stock of free pages zeroed ahead
+   of time in each pool, so that single-page PAL_ZERO requests, such as
+   page tables and user stacks, do not pay for the memset. */
 
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/slab.h"
+#include "threads/spinlock.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
+/*! Number of free block sizes.  Blocks of order BUDDY_ORDERS - 1 are
+    2 GB, more than any pool can hold. */
+#define BUDDY_ORDERS 20
+
+/*! Value of order_of[] for a page that does not start a free block. */
+#define NOT_FREE 0xff
+
+/*! Most pages a magazine holds. */
+#define MAG_SIZE 32
+
+/*! Pages moved between a magazine and its pool at a time. */
+#define MAG_BATCH (MAG_SIZE / 2)
+
+/*! Most pre-zeroed pages kept per pool. */
+#define ZERO_TARGET 32
+
+/*! Pages are zeroed ahead of time only while a pool's free lists hold
+    more than this many, so that the stock does not compete with real
+    allocations. */
+#define ZERO_RESERVE (4 * ZERO_TARGET)
+
+/*! A CPU's cache of free single pages from one pool.  Reached through
+    this_mag() with interrupts off, which is all the locking it needs,
+    since no other CPU uses it.  Only the boot CPU is brought up today,
+    so each pool has exactly one. */
+struct magazine {
+    void *pages[MAG_SIZE];              /*!< Free pages, a stack. */
+    int cnt;                            /*!< Number of pages in PAGES. */
+    unsigned long long hits;            /*!< Allocations from PAGES. */
+    unsigned long long misses;          /*!< Allocations that refilled. */
+    unsigned long long frees;           /*!< Frees into PAGES. */
+    unsigned long long drains;          /*!< Batches given back. */
+};
+
 /*! A memory pool. */
 struct pool {
-    struct lock lock;                   /*!< Mutual exclusion. */
-    struct bitmap *used_map;            /*!< Bitmap of free pages. */
+    struct spinlock lock;               /*!< Mutual exclusion. */
+    struct list free_lists[BUDDY_ORDERS]; /*!< Free blocks, by order. */
+    uint8_t *order_of;                  /*!< For each page, the order of
+                                             the free block it starts,
+                                             or NOT_FREE. */
     uint8_t *base;                      /*!< Base of pool. */
+    size_t page_cnt;                    /*!< Number of pages. */
+    size_t free_cnt;                    /*!< Number of free pages. */
+    size_t min_free_cnt;                /*!< Lowest FREE_CNT so far. */
+    unsigned long long failures;        /*!< # of allocations refused. */
+    struct magazine boot_mag;           /*!< The boot CPU's magazine. */
+    void *zeroed[ZERO_TARGET];          /*!< Pre-zeroed pages, a stack.
+                                             Changed with interrupts off. */
+    int zeroed_cnt;                     /*!< Number of pages in ZEROED. */
 };
 
+/* Zeroing statistics. */
+static unsigned long long zeroed_early; /*!< # pages zeroed ahead. */
+static unsigned long long zero_hits;    /*!< # PAL_ZERO pages pre-zeroed. */
+static unsigned long long zero_inline;  /*!< # PAL_ZERO pages zeroed on
+                                             request. */
+
 /*! Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
 static void init_pool(struct pool *, void *base, size_t page_cnt,
                       const char *name);
 static bool page_from_pool(const struct pool *, void *page);
+static size_t buddy_alloc(struct pool *, size_t page_cnt);
+static void buddy_free(struct pool *, size_t page_idx, size_t page_cnt);
+static bool buddy_claim(struct pool *, size_t page_idx, size_t page_cnt);
+static void print_pool_stats(const char *name, struct pool *);
+static size_t pool_alloc(struct pool *, size_t page_cnt);
+static struct magazine *this_mag(struct pool *);
+static void *mag_get(struct pool *);
+static void mag_put(struct pool *, void *page);
+static void mag_drain(struct pool *, struct magazine *, int page_cnt);
+static void *zeroed_get(struct pool *);
+static void zeroed_drain(struct pool *);
+static bool zero_ahead(struct pool *, enum palloc_flags);
 
 /*! Initializes the page allocator.  At most USER_PAGE_LIMIT
     pages are put into the user pool. */
@@ -66,24 +150,62 @@ void palloc_init(size_t user_page_limit) {
     FLAGS, in which case the kernel panics. */
 void * palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
     struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    enum intr_level old_level;
     void *pages;
     size_t page_idx;
 
     if (page_cnt == 0)
         return NULL;
 
-    lock_acquire(&pool->lock);
-    page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-    lock_release(&pool->lock);
+    if (page_cnt == 1 && (flags & PAL_ZERO)) {
+        pages = zeroed_get(pool);
+        if (pages != NULL)
+            return pages;
+    }
+
+    if (page_cnt == 1) {
+        pages = mag_get(pool);
+        if (pages != NULL) {
+            if (flags & PAL_ZERO) {
+                memset(pages, 0, PGSIZE);
+                zero_inline++;
+            }
+            return pages;
+        }
+    }
 
-    if (page_idx != BITMAP_ERROR)
+    page_idx = pool_alloc(pool, page_cnt);
+    if (page_idx == SIZE_MAX) {
+        /* Memory is tight: give the cached pages back and retry.  The
+           thread page cache and empty slabs go first, since their
+           pages land in the magazine. */
+        if (pool == &kernel_pool) {
+            thread_release_pages();
+            if (!intr_context())
+                kmem_reclaim();
+        }
+        old_level = intr_disable();
+        mag_drain(pool, this_mag(pool), MAG_SIZE);
+        zeroed_drain(pool);
+        intr_set_level(old_level);
+        page_idx = pool_alloc(pool, page_cnt);
+    }
+    if (page_idx == SIZE_MAX) {
+        old_level = spinlock_acquire(&pool->lock);
+        pool->failures++;
+        spinlock_release(&pool->lock, old_level);
+    }
+
+    if (page_idx != SIZE_MAX)
         pages = pool->base + PGSIZE * page_idx;
     else
         pages = NULL;
 
     if (pages != NULL) {
-        if (flags & PAL_ZERO)
+        if (flags & PAL_ZERO) {
             memset(pages, 0, PGSIZE * page_cnt);
+            zero_inline += page_cnt;
+        }
     }
     else {
         if (flags & PAL_ASSERT)
@@ -104,9 +226,11 @@ void * palloc_get_page(enum palloc_flags flags) {
     return palloc_get_multiple(flags, 1);
 }
 
-/*! Frees the PAGE_CNT pages starting at PAGES. */
+/*! Frees the PAGE_CNT pages starting at PAGES.  Does not sleep, so it
+    may be called with interrupts off. */
 void palloc_free_multiple(void *pages, size_t page_cnt) {
     struct pool *pool;
+    enum intr_level old_level;
     size_t page_idx;
 
     ASSERT(pg_ofs(pages) == 0);
@@ -121,13 +245,60 @@ void palloc_free_multiple(void *pages, size_t page_cnt) {
         NOT_REACHED();
 
     page_idx = pg_no(pages) - pg_no(pool->base);
+    ASSERT(page_idx + page_cnt <= pool->page_cnt);
 
 #ifndef NDEBUG
     memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-    ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
-    bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+    if (page_cnt == 1) {
+        mag_put(pool, pages);
+        return;
+    }
+
+    old_level = spinlock_acquire(&pool->lock);
+    buddy_free(pool, page_idx, page_cnt);
+    pool->free_cnt += page_cnt;
+    ASSERT(pool->free_cnt <= pool->page_cnt);
+    spinlock_release(&pool->lock, old_level);
+}
+
+/*! Tries to grow the group of PAGE_CNT pages at PAGES, obtained from
+    palloc_get_multiple(), to NEW_PAGE_CNT pages without moving it, by
+    taking the pages that follow it.  Returns true if successful, false
+    if any of those pages is in use, in which case nothing changes.
+    The new pages are not zeroed. */
+bool palloc_extend(void *pages, size_t page_cnt, size_t new_page_cnt) {
+    struct pool *pool;
+    enum intr_level old_level;
+    size_t page_idx;
+    bool success;
+
+    ASSERT(pg_ofs(pages) == 0);
+    ASSERT(page_cnt > 0);
+    if (new_page_cnt <= page_cnt)
+        return true;
+
+    if (page_from_pool(&kernel_pool, pages))
+        pool = &kernel_pool;
+    else if (page_from_pool(&user_pool, pages))
+        pool = &user_pool;
+    else
+        NOT_REACHED();
+
+    page_idx = pg_no(pages) - pg_no(pool->base) + page_cnt;
+    if (page_idx + (new_page_cnt - page_cnt) > pool->page_cnt)
+        return false;
+
+    old_level = spinlock_acquire(&pool->lock);
+    success = buddy_claim(pool, page_idx, new_page_cnt - page_cnt);
+    if (success) {
+        pool->free_cnt -= new_page_cnt - page_cnt;
+        if (pool->free_cnt < pool->min_free_cnt)
+            pool->min_free_cnt = pool->free_cnt;
+    }
+    spinlock_release(&pool->lock, old_level);
+    return success;
 }
 
 /*! Frees the page at PAGE. */
@@ -135,32 +306,367 @@ void palloc_free_page(void *page) {
     palloc_free_multiple(page, 1);
 }
 
+/*! Zeroes one free page ahead of time, for a later PAL_ZERO request.
+    Returns false if there was nothing to do because every pool's stock
+    of pre-zeroed pages is full or its free pages are running low.
+    Called by the idle thread, with interrupts on. */
+bool palloc_zero_ahead(void) {
+    return zero_ahead(&kernel_pool, 0) || zero_ahead(&user_pool, PAL_USER);
+}
+
+/*! Prints page allocator statistics. */
+void palloc_print_stats(void) {
+    print_pool_stats("kernel", &kernel_pool);
+    print_pool_stats("user", &user_pool);
+    printf("Palloc: %llu pages zeroed ahead, PAL_ZERO served %llu pages "
+           "pre-zeroed and zeroed %llu on request\n",
+           zeroed_early, zero_hits, zero_inline);
+}
+
+/*! Prints the statistics of POOL, called NAME. */
+static void print_pool_stats(const char *name, struct pool *pool) {
+    struct magazine *mag = this_mag(pool);
+    enum intr_level old_level;
+    size_t free_cnt, min_free_cnt;
+    unsigned long long failures, gets;
+    int order, largest = -1;
+
+    old_level = spinlock_acquire(&pool->lock);
+    free_cnt = pool->free_cnt + mag->cnt + pool->zeroed_cnt;
+    min_free_cnt = pool->min_free_cnt;
+    failures = pool->failures;
+    for (order = 0; order < BUDDY_ORDERS; order++)
+        if (!list_empty(&pool->free_lists[order]))
+            largest = order;
+    spinlock_release(&pool->lock, old_level);
+
+    printf("Palloc: %s pool: %zu of %zu pages free (low %zu), "
+           "largest free block %zu pages, %llu failures\n",
+           name, free_cnt, pool->page_cnt, min_free_cnt,
+           largest >= 0 ? (size_t) 1 << largest : 0, failures);
+
+    gets = mag->hits + mag->misses;
+    printf("Palloc: %s magazine: %llu of %llu single-page allocations hit "
+           "(%llu%%), %llu frees cached, %llu batches drained\n",
+           name, mag->hits, gets, gets > 0 ? mag->hits * 100 / gets : 0,
+           mag->frees, mag->drains);
+}
+
+/*! Allocates PAGE_CNT contiguous pages from POOL, bypassing the
+    magazines, and returns the index of the first one, or SIZE_MAX if
+    POOL has no block large enough. */
+static size_t pool_alloc(struct pool *pool, size_t page_cnt) {
+    enum intr_level old_level = spinlock_acquire(&pool->lock);
+    size_t page_idx = buddy_alloc(pool, page_cnt);
+
+    if (page_idx != SIZE_MAX) {
+        pool->free_cnt -= page_cnt;
+        if (pool->free_cnt < pool->min_free_cnt)
+            pool->min_free_cnt = pool->free_cnt;
+    }
+    spinlock_release(&pool->lock, old_level);
+    return page_idx;
+}
+
+/*! Returns the running CPU's magazine for POOL. */
+static struct magazine *this_mag(struct pool *pool) {
+    return &pool->boot_mag;
+}
+
+/*! Takes a page from the running CPU's magazine for POOL, first
+    refilling the magazine from POOL if it is empty.  Returns a null
+    pointer if POOL has no free page outside the magazine either. */
+static void *mag_get(struct pool *pool) {
+    enum intr_level old_level = intr_disable();
+    struct magazine *mag = this_mag(pool);
+    void *page = NULL;
+
+    if (mag->cnt > 0)
+        mag->hits++;
+    else {
+        enum intr_level pool_level = spinlock_acquire(&pool->lock);
+        while (mag->cnt < MAG_BATCH) {
+            size_t page_idx = buddy_alloc(pool, 1);
+            if (page_idx == SIZE_MAX)
+                break;
+            mag->pages[mag->cnt++] = pool->base + PGSIZE * page_idx;
+        }
+        pool->free_cnt -= mag->cnt;
+        if (pool->free_cnt < pool->min_free_cnt)
+            pool->min_free_cnt = pool->free_cnt;
+        spinlock_release(&pool->lock, pool_level);
+        mag->misses++;
+    }
+    if (mag->cnt > 0)
+        page = mag->pages[--mag->cnt];
+    intr_set_level(old_level);
+    return page;
+}
+
+/*! Puts free PAGE into the running CPU's magazine for POOL, first
+    giving a batch back to POOL if the magazine is full. */
+static void mag_put(struct pool *pool, void *page) {
+    enum intr_level old_level = intr_disable();
+    struct magazine *mag = this_mag(pool);
+
+    if (mag->cnt == MAG_SIZE)
+        mag_drain(pool, mag, MAG_BATCH);
+    mag->pages[mag->cnt++] = page;
+    mag->frees++;
+    intr_set_level(old_level);
+}
+
+/*! Gives up to PAGE_CNT pages from MAG back to POOL.  Interrupts must
+    be off. */
+static void mag_drain(struct pool *pool, struct magazine *mag,
+                      int page_cnt) {
+    enum intr_level old_level;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (mag->cnt == 0)
+        return;
+    old_level = spinlock_acquire(&pool->lock);
+    for (; page_cnt > 0 && mag->cnt > 0; page_cnt--) {
+        void *page = mag->pages[--mag->cnt];
+        buddy_free(pool, pg_no(page) - pg_no(pool->base), 1);
+        pool->free_cnt++;
+    }
+    spinlock_release(&pool->lock, old_level);
+    mag->drains++;
+}
+
+/*! Takes a page from POOL's stock of pre-zeroed pages.  Returns a
+    null pointer if the stock is empty. */
+static void *zeroed_get(struct pool *pool) {
+    enum intr_level old_level = intr_disable();
+    void *page = NULL;
+
+    if (pool->zeroed_cnt > 0) {
+        page = pool->zeroed[--pool->zeroed_cnt];
+        zero_hits++;
+    }
+    intr_set_level(old_level);
+    return page;
+}
+
+/*! Gives POOL's pre-zeroed pages back to its free lists.  Interrupts
+    must be off. */
+static void zeroed_drain(struct pool *pool) {
+    enum intr_level old_level;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (pool->zeroed_cnt == 0)
+        return;
+    old_level = spinlock_acquire(&pool->lock);
+    while (pool->zeroed_cnt > 0) {
+        void *page = pool->zeroed[--pool->zeroed_cnt];
+        buddy_free(pool, pg_no(page) - pg_no(pool->base), 1);
+        pool->free_cnt++;
+    }
+    spinlock_release(&pool->lock, old_level);
+}
+
+/*! Zeroes a free page from POOL, obtained with FLAGS, and adds it to
+    POOL's stock of pre-zeroed pages.  Returns false if the stock is
+    full or POOL's free lists are running low. */
+static bool zero_ahead(struct pool *pool, enum palloc_flags flags) {
+    enum intr_level old_level;
+    void *page;
+
+    if (pool->zeroed_cnt >= ZERO_TARGET || pool->free_cnt <= ZERO_RESERVE)
+        return false;
+    page = palloc_get_page(flags);
+    if (page == NULL)
+        return false;
+    memset(page, 0, PGSIZE);
+
+    old_level = intr_disable();
+    if (pool->zeroed_cnt < ZERO_TARGET) {
+        pool->zeroed[pool->zeroed_cnt++] = page;
+        zeroed_early++;
+        page = NULL;
+    }
+    intr_set_level(old_level);
+
+    if (page != NULL) {
+        palloc_free_page(page);
+        return false;
+    }
+    return true;
+}
+
 /*! Initializes pool P as starting at START and ending at END,
     naming it NAME for debugging purposes. */
 static void init_pool(struct pool *p, void *base, size_t page_cnt,
                       const char *name) {
-    /* We'll put the pool's used_map at its base.
-       Calculate the space needed for the bitmap
+    /* We'll put the pool's order_of map at its base.
+       Calculate the space needed for the map
        and subtract it from the pool's size. */
-    size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(page_cnt), PGSIZE);
-    if (bm_pages > page_cnt)
-        PANIC("Not enough memory in %s for bitmap.", name);
-    page_cnt -= bm_pages;
+    size_t map_pages = DIV_ROUND_UP(page_cnt, PGSIZE);
+    int order;
+    if (map_pages > page_cnt)
+        PANIC("Not enough memory in %s for page map.", name);
+    page_cnt -= map_pages;
 
     printf("%zu pages available in %s.\n", page_cnt, name);
 
     /* Initialize the pool. */
-    lock_init(&p->lock);
-    p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
-    p->base = base + bm_pages * PGSIZE;
+    spinlock_init(&p->lock);
+    for (order = 0; order < BUDDY_ORDERS; order++)
+        list_init(&p->free_lists[order]);
+    p->order_of = base;
+    memset(p->order_of, NOT_FREE, page_cnt);
+    p->base = (uint8_t *) base + map_pages * PGSIZE;
+    p->page_cnt = page_cnt;
+
+    /* Free every page. */
+    buddy_free(p, 0, page_cnt);
+    p->free_cnt = p->min_free_cnt = page_cnt;
+    p->failures = 0;
+    memset(&p->boot_mag, 0, sizeof p->boot_mag);
+    p->zeroed_cnt = 0;
 }
 
 /*! Returns true if PAGE was allocated from POOL, false otherwise. */
 static bool page_from_pool(const struct pool *pool, void *page) {
     size_t page_no = pg_no(page);
     size_t start_page = pg_no(pool->base);
-    size_t end_page = start_page + bitmap_size(pool->used_map);
+    size_t end_page = start_page + pool->page_cnt;
 
     return page_no >= start_page && page_no < end_page;
 }
 
+/*! Returns the list element kept at the start of POOL's free block
+    that begins at page PAGE_IDX. */
+static struct list_elem * block_elem(const struct pool *pool,
+                                     size_t page_idx) {
+    return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/*! Adds the block of 2**ORDER pages at PAGE_IDX to POOL's free lists,
+    without merging it. */
+static void block_push(struct pool *pool, size_t page_idx, int order) {
+    pool->order_of[page_idx] = order;
+    list_push_front(&pool->free_lists[order], block_elem(pool, page_idx));
+}
+
+/*! Takes the free block at PAGE_IDX off POOL's free lists. */
+static void block_remove(struct pool *pool, size_t page_idx) {
+    pool->order_of[page_idx] = NOT_FREE;
+    list_remove(block_elem(pool, page_idx));
+}
+
+/*! Allocates PAGE_CNT contiguous pages from POOL and returns the index
+    of the first one, or SIZE_MAX if there is no block large enough.
+    POOL's lock must be held. */
+static size_t buddy_alloc(struct pool *pool, size_t page_cnt) {
+    size_t page_idx;
+    int want, order;
+
+    ASSERT(spinlock_held(&pool->lock));
+
+    /* Find the smallest free block that holds PAGE_CNT pages. */
+    for (want = 0; want < BUDDY_ORDERS; want++)
+        if (((size_t) 1 << want) >= page_cnt)
+            break;
+    for (order = want; order < BUDDY_ORDERS; order++)
+        if (!list_empty(&pool->free_lists[order]))
+            break;
+    if (order >= BUDDY_ORDERS)
+        return SIZE_MAX;
+
+    page_idx = pg_no(list_front(&pool->free_lists[order]))
+               - pg_no(pool->base);
+    block_remove(pool, page_idx);
+
+    /* Split off upper halves until the block is just large enough,
+       then give back the pages past PAGE_CNT. */
+    while (order > want) {
+        order--;
+        block_push(pool, page_idx + ((size_t) 1 << order), order);
+    }
+    buddy_free(pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+    return page_idx;
+}
+
+/*! Returns the index of the page that starts the free block of POOL
+    holding page PAGE_IDX, storing the block's order in *ORDER, or
+    SIZE_MAX if the page is not free. */
+static size_t buddy_find(const struct pool *pool, size_t page_idx,
+                         int *order) {
+    int o;
+
+    for (o = 0; o < BUDDY_ORDERS; o++) {
+        size_t head = page_idx & ~(((size_t) 1 << o) - 1);
+        if (pool->order_of[head] == o) {
+            *order = o;
+            return head;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/*! Takes the PAGE_CNT pages starting at PAGE_IDX out of POOL's free
+    lists, if every one of them is free, and returns true.  Otherwise
+    returns false without changing anything.  POOL's lock must be
+    held. */
+static bool buddy_claim(struct pool *pool, size_t page_idx,
+                        size_t page_cnt) {
+    size_t end = page_idx + page_cnt;
+    size_t idx;
+    int order;
+
+    ASSERT(spinlock_held(&pool->lock));
+
+    /* Check that the free blocks holding the range cover it. */
+    for (idx = page_idx; idx < end; ) {
+        size_t head = buddy_find(pool, idx, &order);
+        if (head == SIZE_MAX)
+            return false;
+        idx = head + ((size_t) 1 << order);
+    }
+
+    /* Take each of those blocks and give back its pages outside the
+       range. */
+    for (idx = page_idx; idx < end; ) {
+        size_t head = buddy_find(pool, idx, &order);
+        size_t block_end = head + ((size_t) 1 << order);
+
+        block_remove(pool, head);
+        buddy_free(pool, head, idx - head);
+        if (block_end > end)
+            buddy_free(pool, end, block_end - end);
+        idx = block_end;
+    }
+    return true;
+}
+
+/*! Returns the PAGE_CNT pages starting at PAGE_IDX to POOL's free
+    lists, merging them with free buddies. */
+static void buddy_free(struct pool *pool, size_t page_idx,
+                       size_t page_cnt) {
+    /* Cut the range into the largest aligned blocks it holds. */
+    while (page_cnt > 0) {
+        size_t idx = page_idx;
+        int order = 0;
+
+        while (order + 1 < BUDDY_ORDERS && (idx & ((size_t) 1 << order)) == 0
+               && ((size_t) 2 << order) <= page_cnt)
+            order++;
+        page_idx += (size_t) 1 << order;
+        page_cnt -= (size_t) 1 << order;
+
+        /* Merge with the buddy as long as it is free and whole. */
+        while (order + 1 < BUDDY_ORDERS) {
+            size_t buddy = idx ^ ((size_t) 1 << order);
+            if (buddy >= pool->page_cnt || pool->order_of[buddy] != order)
+                break;
+            block_remove(pool, buddy);
+            idx &= ~((size_t) 1 << order);
+            order++;
+        }
+        block_push(pool, idx, order);
+    }
+}
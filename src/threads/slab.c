@@ -0,0 +1,323 @@
+/*! \file slab.c
+
+   Object caches, after Bonwick's slab allocator.
+
+   A cache hands out objects of one size.  It carves them out of
+   "slabs", each a single page from the page allocator, which begins
+   with a struct slab header followed by an array of free object
+   indexes and then the objects themselves.  Objects are packed at
+   their own size, rounded up only for alignment, so a 560-byte object
+   takes 560 bytes rather than the 1 kB that malloc() would use.
+
+   A cache keeps its slabs on three lists: those with some objects in
+   use and some free, which allocation draws from first; those with
+   every object in use; and those with none in use.  A slab whose last
+   object is freed is given back to the page allocator right away,
+   except that one is kept to absorb a cache that keeps allocating and
+   freeing a single object.  kmem_cache_reclaim() gives back that one
+   too, and the page allocator calls kmem_reclaim() to do so for every
+   cache when it runs out of pages.
+
+   Free objects are tracked by index in the slab header rather than by
+   a pointer stored in the object, so a free object keeps whatever its
+   constructor or its last user left in it. */
+
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/*! Alignment of objects within a slab. */
+#define KMEM_ALIGN 8
+
+/*! Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/*! Marks the end of a slab's free index chain. */
+#define NO_OBJECT UINT16_MAX
+
+/*! An object cache. */
+struct kmem_cache {
+    char name[16];                      /*!< Name, for statistics. */
+    size_t obj_size;                    /*!< Size of each object. */
+    size_t objs_per_slab;               /*!< Objects in each slab. */
+    size_t obj_ofs;                     /*!< Offset of first object. */
+    kmem_ctor *ctor;                    /*!< Constructor, or NULL. */
+    struct lock lock;                   /*!< Protects the members below. */
+    struct lock_profile profile;        /*!< Contention on LOCK. */
+    struct list partial;                /*!< Slabs partly in use. */
+    struct list full;                   /*!< Slabs wholly in use. */
+    struct list empty;                  /*!< Slabs wholly free. */
+    size_t slab_cnt;                    /*!< Number of slabs. */
+    size_t in_use;                      /*!< Objects allocated. */
+    size_t peak_in_use;                 /*!< Most objects ever allocated. */
+    unsigned long long allocs;          /*!< # of kmem_cache_alloc(). */
+    unsigned long long frees;           /*!< # of kmem_cache_free(). */
+    struct list_elem elem;              /*!< Element in all_caches. */
+};
+
+/*! Header at the start of each slab's page. */
+struct slab {
+    unsigned magic;                     /*!< Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;           /*!< Owning cache. */
+    struct list_elem elem;              /*!< In one of the cache's lists. */
+    size_t in_use;                      /*!< Objects allocated. */
+    uint16_t first_free;                /*!< First free object's index. */
+    uint16_t next_free[];               /*!< Next free index, per object. */
+};
+
+/*! All caches, in the order they were created.  Caches are never
+    destroyed, so this only grows. */
+static struct list all_caches = LIST_INITIALIZER(all_caches);
+
+static void cache_reclaim(struct kmem_cache *);
+static struct slab *slab_create(struct kmem_cache *);
+static void slab_destroy(struct kmem_cache *, struct slab *);
+static struct slab *obj_to_slab(void *obj);
+static void *slab_obj(struct kmem_cache *, struct slab *, size_t idx);
+
+/*! Creates and returns a cache of SIZE-byte objects called NAME.  If
+    CTOR is non-null, it is applied to each object as its slab is
+    created.  Returns a null pointer if memory is not available.
+
+    Objects must be small enough that a page holds at least one. */
+struct kmem_cache *kmem_cache_create(const char *name, size_t size,
+                                     kmem_ctor *ctor) {
+    struct kmem_cache *c;
+    enum intr_level old_level;
+    size_t n;
+
+    ASSERT(name != NULL);
+    ASSERT(size > 0);
+
+    c = malloc(sizeof *c);
+    if (c == NULL)
+        return NULL;
+
+    strlcpy(c->name, name, sizeof c->name);
+    c->obj_size = ROUND_UP(size, KMEM_ALIGN);
+    c->ctor = ctor;
+
+    /* Fit as many objects as the page holds along with the header and
+       one free index per object. */
+    n = (PGSIZE - sizeof(struct slab)) / (c->obj_size + sizeof(uint16_t));
+    while (n > 0 && ROUND_UP(sizeof(struct slab) + n * sizeof(uint16_t),
+                             KMEM_ALIGN) + n * c->obj_size > PGSIZE)
+        n--;
+    ASSERT(n > 0);
+    c->objs_per_slab = n;
+    c->obj_ofs = ROUND_UP(sizeof(struct slab) + n * sizeof(uint16_t),
+                          KMEM_ALIGN);
+
+    lock_init(&c->lock);
+    lock_profile(&c->lock, &c->profile, c->name);
+    list_init(&c->partial);
+    list_init(&c->full);
+    list_init(&c->empty);
+    c->slab_cnt = 0;
+    c->in_use = c->peak_in_use = 0;
+    c->allocs = c->frees = 0;
+
+    old_level = intr_disable();
+    list_push_back(&all_caches, &c->elem);
+    intr_set_level(old_level);
+    return c;
+}
+
+/*! Allocates and returns an object from cache C.  Returns a null
+    pointer if memory is not available. */
+void *kmem_cache_alloc(struct kmem_cache *c) {
+    struct slab *s;
+    void *obj;
+
+    lock_acquire(&c->lock);
+
+    /* Take an object from a partly used slab, a wholly free slab or,
+       failing that, a new slab. */
+    if (!list_empty(&c->partial))
+        s = list_entry(list_front(&c->partial), struct slab, elem);
+    else if (!list_empty(&c->empty)) {
+        s = list_entry(list_pop_front(&c->empty), struct slab, elem);
+        list_push_front(&c->partial, &s->elem);
+    }
+    else {
+        s = slab_create(c);
+        if (s == NULL) {
+            lock_release(&c->lock);
+            return NULL;
+        }
+        list_push_front(&c->partial, &s->elem);
+    }
+
+    ASSERT(s->first_free != NO_OBJECT);
+    obj = slab_obj(c, s, s->first_free);
+    s->first_free = s->next_free[s->first_free];
+    if (++s->in_use == c->objs_per_slab) {
+        list_remove(&s->elem);
+        list_push_front(&c->full, &s->elem);
+    }
+
+    c->allocs++;
+    if (++c->in_use > c->peak_in_use)
+        c->peak_in_use = c->in_use;
+    lock_release(&c->lock);
+    return obj;
+}
+
+/*! Returns OBJ, which must have been allocated from cache C, to C. */
+void kmem_cache_free(struct kmem_cache *c, void *obj) {
+    struct slab *s;
+    size_t idx;
+
+    if (obj == NULL)
+        return;
+
+    s = obj_to_slab(obj);
+    ASSERT(s->cache == c);
+    idx = ((uint8_t *) obj - ((uint8_t *) s + c->obj_ofs)) / c->obj_size;
+    ASSERT(slab_obj(c, s, idx) == obj);
+
+#ifndef NDEBUG
+    /* Clear the object to help detect use-after-free bugs, unless it
+       must keep its constructed state. */
+    if (c->ctor == NULL)
+        memset(obj, 0xcc, c->obj_size);
+#endif
+
+    lock_acquire(&c->lock);
+    ASSERT(s->in_use > 0);
+    s->next_free[idx] = s->first_free;
+    s->first_free = idx;
+    list_remove(&s->elem);
+    if (--s->in_use > 0)
+        list_push_front(&c->partial, &s->elem);
+    else if (list_empty(&c->empty))
+        list_push_front(&c->empty, &s->elem);
+    else
+        slab_destroy(c, s);
+    c->frees++;
+    c->in_use--;
+    lock_release(&c->lock);
+}
+
+/*! Gives every wholly free slab of cache C back to the page
+    allocator. */
+void kmem_cache_reclaim(struct kmem_cache *c) {
+    lock_acquire(&c->lock);
+    cache_reclaim(c);
+    lock_release(&c->lock);
+}
+
+/*! Gives the wholly free slabs of every cache back to the page
+    allocator, for use when it has run out of pages.  Never sleeps: a
+    cache whose lock is taken is skipped, including one whose lock the
+    caller holds because it is growing that cache.  Must not be called
+    from an interrupt handler. */
+void kmem_reclaim(void) {
+    struct list_elem *e;
+
+    ASSERT(!intr_context());
+
+    /* Caches are only ever appended to the list, never removed. */
+    for (e = list_begin(&all_caches); e != list_end(&all_caches);
+         e = list_next(e)) {
+        struct kmem_cache *c = list_entry(e, struct kmem_cache, elem);
+
+        if (lock_held_by_current_thread(&c->lock)
+            || !lock_try_acquire(&c->lock))
+            continue;
+        cache_reclaim(c);
+        lock_release(&c->lock);
+    }
+}
+
+/*! Gives every wholly free slab of cache C back to the page
+    allocator.  C's lock must be held. */
+static void cache_reclaim(struct kmem_cache *c) {
+    ASSERT(lock_held_by_current_thread(&c->lock));
+
+    while (!list_empty(&c->empty)) {
+        struct slab *s = list_entry(list_pop_front(&c->empty),
+                                    struct slab, elem);
+        slab_destroy(c, s);
+    }
+}
+
+/*! Prints statistics for every cache. */
+void kmem_print_stats(void) {
+    struct list_elem *e;
+
+    for (e = list_begin(&all_caches); e != list_end(&all_caches);
+         e = list_next(e)) {
+        struct kmem_cache *c = list_entry(e, struct kmem_cache, elem);
+
+        lock_acquire(&c->lock);
+        printf("Slab: %s: %zu-byte objects, %zu per page, %zu in use "
+               "(peak %zu), %zu pages, %llu allocs, %llu frees\n",
+               c->name, c->obj_size, c->objs_per_slab, c->in_use,
+               c->peak_in_use, c->slab_cnt, c->allocs, c->frees);
+        lock_release(&c->lock);
+    }
+}
+
+/*! Creates a new slab for cache C, with every object free and
+    constructed.  Returns a null pointer if memory is not available.
+    C's lock must be held. */
+static struct slab *slab_create(struct kmem_cache *c) {
+    struct slab *s;
+    size_t i;
+
+    ASSERT(lock_held_by_current_thread(&c->lock));
+
+    s = palloc_get_page(0);
+    if (s == NULL)
+        return NULL;
+
+    s->magic = SLAB_MAGIC;
+    s->cache = c;
+    s->in_use = 0;
+    s->first_free = 0;
+    for (i = 0; i < c->objs_per_slab; i++) {
+        s->next_free[i] = i + 1 < c->objs_per_slab ? i + 1 : NO_OBJECT;
+        if (c->ctor != NULL)
+            c->ctor(slab_obj(c, s, i));
+    }
+    c->slab_cnt++;
+    return s;
+}
+
+/*! Gives slab S, which must be wholly free and on none of cache C's
+    lists, back to the page allocator.  C's lock must be held. */
+static void slab_destroy(struct kmem_cache *c, struct slab *s) {
+    ASSERT(lock_held_by_current_thread(&c->lock));
+    ASSERT(s->in_use == 0);
+
+    s->magic = 0;
+    c->slab_cnt--;
+    palloc_free_page(s);
+}
+
+/*! Returns the slab that object OBJ is inside. */
+static struct slab *obj_to_slab(void *obj) {
+    struct slab *s = pg_round_down(obj);
+
+    /* Check that the slab is valid. */
+    ASSERT(s != NULL);
+    ASSERT(s->magic == SLAB_MAGIC);
+
+    return s;
+}
+
+/*! Returns object IDX within slab S of cache C. */
+static void *slab_obj(struct kmem_cache *c, struct slab *s, size_t idx) {
+    ASSERT(idx < c->objs_per_slab);
+    return (uint8_t *) s + c->obj_ofs + idx * c->obj_size;
+}
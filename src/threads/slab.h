@@ -0,0 +1,27 @@
+/*! \file slab.h
+ *
+ * Object caches, for kernel objects of a fixed size that are allocated
+ * and freed often.
+ */
+
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/*! Prepares OBJ, a new object of its cache, for first use.  Objects
+    must be returned to the cache in the same state, since it is not
+    called again when an object is reused. */
+typedef void kmem_ctor(void *obj);
+
+struct kmem_cache;
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size,
+                                     kmem_ctor *);
+void *kmem_cache_alloc(struct kmem_cache *);
+void kmem_cache_free(struct kmem_cache *, void *);
+void kmem_cache_reclaim(struct kmem_cache *);
+void kmem_reclaim(void);
+void kmem_print_stats(void);
+
+#endif /* threads/slab.h */
@@ -0,0 +1,57 @@
+/*! \file spinlock.h
+ *
+ * Spinlocks, for the short critical sections that must exclude
+ * interrupt handlers as well as other threads.
+ */
+
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <debug.h>
+#include "threads/interrupt.h"
+
+/*! A spinlock.  Acquiring it turns interrupts off on this CPU and then
+    takes the lock word, so that the critical section also excludes
+    code running on other CPUs.  On a uniprocessor the lock word can
+    never be found taken, except by a recursive acquire, which is a
+    bug. */
+struct spinlock {
+    int locked;                 /*!< Nonzero while held. */
+};
+
+/*! Initializer for a spinlock with static storage duration. */
+#define SPINLOCK_INITIALIZER { 0 }
+
+/*! Initializes spinlock SL. */
+static inline void spinlock_init(struct spinlock *sl) {
+    sl->locked = 0;
+}
+
+/*! Turns interrupts off, acquires SL, and returns the previous
+    interrupt level, to be passed to spinlock_release(). */
+static inline enum intr_level spinlock_acquire(struct spinlock *sl) {
+    enum intr_level old_level = intr_disable();
+
+    ASSERT(!sl->locked);
+    while (__sync_lock_test_and_set(&sl->locked, 1))
+        asm volatile ("pause" : : : "memory");
+    return old_level;
+}
+
+/*! Releases SL, then restores the interrupt level OLD_LEVEL returned
+    by the matching spinlock_acquire(). */
+static inline void spinlock_release(struct spinlock *sl,
+                                    enum intr_level old_level) {
+    ASSERT(sl->locked);
+
+    __sync_lock_release(&sl->locked);
+    intr_set_level(old_level);
+}
+
+/*! Returns true if SL is held.  Only meaningful as an assertion by the
+    holder. */
+static inline bool spinlock_held(const struct spinlock *sl) {
+    return sl->locked != 0;
+}
+
+#endif /* threads/spinlock.h */
@@ -36,6 +36,115 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/tsc.h"
+
+static bool waiter_higher_priority(const struct list_elem *a,
+                                   const struct list_elem *b,
+                                   void *aux UNUSED);
+static void thread_donate(struct thread *, int priority);
+static void rwlock_donate_readers(struct rwlock *, int priority);
+
+/*! Initializes wait queue Q to empty. */
+void wait_queue_init(struct wait_queue *q) {
+    ASSERT(q != NULL);
+
+    list_init(&q->waiters);
+}
+
+/*! Returns true if no thread is waiting on Q. */
+bool wait_queue_empty(struct wait_queue *q) {
+    return list_empty(&q->waiters);
+}
+
+/*! Orders waiters by descending effective priority.  Since
+    list_insert_ordered() inserts after equal elements, waiters of the
+    same priority are woken in FIFO order. */
+static bool waiter_higher_priority(const struct list_elem *a,
+                                   const struct list_elem *b,
+                                   void *aux UNUSED) {
+    const struct waiter *wa = list_entry(a, struct waiter, elem);
+    const struct waiter *wb = list_entry(b, struct waiter, elem);
+
+    return compute_priority(wa->thread) > compute_priority(wb->thread);
+}
+
+/*! Enqueues the current thread on Q through W, which must stay valid
+    until the thread is woken.  Interrupts must be off; the caller
+    goes to sleep with wait_queue_block(). */
+void wait_queue_push(struct wait_queue *q, struct waiter *w) {
+    struct thread *cur = thread_current();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    w->thread = cur;
+    w->queue = q;
+    cur->waiter = w;
+    list_insert_ordered(&q->waiters, &w->elem, waiter_higher_priority, NULL);
+}
+
+/*! Sleeps until W, pushed by wait_queue_push(), has been woken.
+    Interrupts must be off. */
+void wait_queue_block(struct waiter *w) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (w->queue != NULL)
+        thread_block();
+}
+
+/*! Blocks the current thread on Q until it is woken.  Interrupts
+    must be off. */
+void wait_queue_wait(struct wait_queue *q) {
+    struct waiter w;
+
+    wait_queue_push(q, &w);
+    wait_queue_block(&w);
+}
+
+/*! Wakes the highest-priority thread waiting on Q and returns it, or
+    returns NULL if Q is empty.  Interrupts must be off.  May be called
+    from an interrupt handler. */
+struct thread *wait_queue_wake(struct wait_queue *q) {
+    struct waiter *w;
+    struct thread *t;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (list_empty(&q->waiters))
+        return NULL;
+
+    w = list_entry(list_pop_front(&q->waiters), struct waiter, elem);
+    t = w->thread;
+    w->queue = NULL;
+    t->waiter = NULL;
+    /* A waiter pushed but not yet blocked just finds its queue gone. */
+    if (t->status == THREAD_BLOCKED)
+        thread_unblock(t);
+    return t;
+}
+
+/*! Returns the highest effective priority among Q's waiters, or
+    PRI_MIN if there are none.  Interrupts must be off. */
+int wait_queue_max_priority(struct wait_queue *q) {
+    if (list_empty(&q->waiters))
+        return PRI_MIN;
+    return compute_priority(list_entry(list_front(&q->waiters),
+                                       struct waiter, elem)->thread);
+}
+
+/*! Moves T to its new place in the wait queue it is blocked on, if
+    any, after its effective priority has changed.  Interrupts must be
+    off. */
+void wait_queue_reorder(struct thread *t) {
+    struct waiter *w = t->waiter;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (w == NULL || w->queue == NULL)
+        return;
+    list_remove(&w->elem);
+    list_insert_ordered(&w->queue->waiters, &w->elem,
+                        waiter_higher_priority, NULL);
+}
 
 /*! Initializes semaphore SEMA to VALUE.  A semaphore is a
     nonnegative integer along with two atomic operators for
@@ -50,7 +159,7 @@ void sema_init(struct semaphore *sema, unsigned value) {
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    wait_queue_init(&sema->waiters);
 }
 
 /*! Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -67,10 +176,8 @@ void sema_down(struct semaphore *sema) {
     ASSERT(!intr_context());
 
     old_level = intr_disable();
-    while (sema->value == 0) {
-        list_push_back(&sema->waiters, &thread_current()->elem);
-        thread_block();
-    }
+    while (sema->value == 0)
+        wait_queue_wait(&sema->waiters);
     sema->value--;
     intr_set_level(old_level);
 }
@@ -110,27 +217,12 @@ void sema_up(struct semaphore *sema) {
 
     old_level = intr_disable();
     sema->value++;
-    if (!list_empty(&sema->waiters)) {
-        struct list_elem *e = list_begin(&sema->waiters);
-        struct thread *wake_thread = list_entry(e, struct thread, elem);
-        int max_priority = compute_priority(wake_thread);
-
-        for (e = list_next(e); e != list_end(&sema->waiters); 
-             e = list_next(e)) { 
-            struct thread *t = list_entry(e, struct thread, elem);
-            int priority = compute_priority(t);
-            if (priority > max_priority) { 
-                max_priority = priority;
-                wake_thread = t;
-            }
-        }
-
-        list_remove(&wake_thread->elem);
-        thread_unblock(wake_thread);
-        if (max_priority >= thread_get_priority()) {
+    struct thread *t = wait_queue_wake(&sema->waiters);
+    if (t != NULL && compute_priority(t) >= thread_get_priority()) {
+        if (intr_context())
+            intr_yield_on_return();
+        else
             thread_yield();
-        } 
-
     }
     intr_set_level(old_level);
 }
@@ -180,13 +272,172 @@ static void sema_test_helper(void *sema_) {
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   The holder word is the whole state of an uncontended lock, so
+   acquiring or releasing one is a single compare-and-swap, with
+   interrupts left on.  Threads that find the lock held queue up on
+   it with interrupts off, and a release hands the lock directly to
+   the first of them. */
 void lock_init(struct lock *lock) {
     ASSERT(lock != NULL);
 
     lock->holder = NULL;
     lock->donated_priority = PRI_MIN;
-    sema_init(&lock->semaphore, 1);
+    lock->donee = NULL;
+    lock->profile = NULL;
+    wait_queue_init(&lock->waiters);
+}
+
+/*! If false (default), lock_profile() does nothing. */
+bool lock_profiling;
+
+/*! All lock profiles, in the order they were set up. */
+static struct list lock_profiles = LIST_INITIALIZER(lock_profiles);
+
+/*! Starts keeping contention statistics for LOCK in PROFILE, reported
+    under NAME by lock_print_stats(), if profiling was turned on with
+    "-lockprof".  LOCK must not be held, and both must stay around until
+    shutdown. */
+void lock_profile(struct lock *lock, struct lock_profile *profile,
+                  const char *name) {
+    enum intr_level old_level;
+
+    ASSERT(lock != NULL && profile != NULL && name != NULL);
+    ASSERT(lock->holder == NULL);
+
+    if (!lock_profiling)
+        return;
+
+    memset(profile, 0, sizeof *profile);
+    strlcpy(profile->name, name, sizeof profile->name);
+
+    old_level = intr_disable();
+    list_push_back(&lock_profiles, &profile->elem);
+    lock->profile = profile;
+    intr_set_level(old_level);
+}
+
+/*! Records that the current thread, called from CALLER, just got LOCK,
+    which has a profile.  If WAITED, it had to wait WAIT cycles. */
+static void lock_profile_acquired(struct lock *lock, void *caller,
+                                  bool waited, uint64_t wait) {
+    struct lock_profile *p = lock->profile;
+    struct lock_site *site, *min;
+
+    p->acquired_at = tsc_read();
+    p->acquisitions++;
+    if (!waited)
+        return;
+
+    p->contended++;
+    p->wait_cycles += wait;
+    if (wait > p->max_wait_cycles)
+        p->max_wait_cycles = wait;
+
+    /* Charge CALLER's site, taking over the site that has waited least
+       if CALLER is new and the table is full. */
+    min = &p->sites[0];
+    for (site = p->sites; site < p->sites + LOCK_PROFILE_SITES; site++) {
+        if (site->caller == caller)
+            break;
+        if (site->wait_cycles < min->wait_cycles)
+            min = site;
+    }
+    if (site == p->sites + LOCK_PROFILE_SITES) {
+        site = min;
+        site->caller = caller;
+        site->waits = 0;
+        site->wait_cycles = 0;
+    }
+    site->waits++;
+    site->wait_cycles += wait;
+}
+
+/*! Records that LOCK, which has a profile, is about to be released. */
+static void lock_profile_released(struct lock *lock) {
+    struct lock_profile *p = lock->profile;
+    uint64_t hold = tsc_read() - p->acquired_at;
+
+    p->hold_cycles += hold;
+    if (hold > p->max_hold_cycles)
+        p->max_hold_cycles = hold;
+}
+
+/*! Compares lock sites by total wait, longest first. */
+static bool site_waited_longer(const struct lock_site *a,
+                               const struct lock_site *b) {
+    return a->wait_cycles > b->wait_cycles;
+}
+
+/*! Prints contention statistics for every profiled lock that a
+    thread ever had to wait for. */
+void lock_print_stats(void) {
+    struct list_elem *e;
+
+    for (e = list_begin(&lock_profiles); e != list_end(&lock_profiles);
+         e = list_next(e)) {
+        struct lock_profile *p = list_entry(e, struct lock_profile, elem);
+        struct lock_site sites[LOCK_PROFILE_SITES];
+        int i, j;
+
+        if (p->contended == 0)
+            continue;
+
+        printf("Lock %s: %llu acquisitions, %llu contended, "
+               "wait %llu us (max %llu us), hold %llu us (max %llu us)\n",
+               p->name, p->acquisitions, p->contended,
+               tsc_to_us(p->wait_cycles), tsc_to_us(p->max_wait_cycles),
+               tsc_to_us(p->hold_cycles), tsc_to_us(p->max_hold_cycles));
+
+        /* Insertion sort of a copy, longest waiters first. */
+        for (i = 0; i < LOCK_PROFILE_SITES; i++) {
+            for (j = i; j > 0 && site_waited_longer(&p->sites[i],
+                                                    &sites[j - 1]); j--)
+                sites[j] = sites[j - 1];
+            sites[j] = p->sites[i];
+        }
+        for (i = 0; i < LOCK_PROFILE_SITES && sites[i].caller != NULL; i++)
+            printf("  waiter at %p: %llu waits, %llu us\n",
+                   sites[i].caller, sites[i].waits,
+                   tsc_to_us(sites[i].wait_cycles));
+    }
+}
+
+/*! Puts LOCK on its holder's list of locks with waiters, through
+    which thread_recompute_priority() finds the donations it
+    receives.  The lock may still be on the list of a previous holder
+    that is in the middle of releasing it, which recomputes its own
+    priority afterward.  Interrupts must be off. */
+static void lock_list_add(struct lock *lock) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (lock->donee != lock->holder) {
+        if (lock->donee != NULL)
+            list_remove(&lock->elem);
+        list_push_back(&lock->holder->lock_list, &lock->elem);
+        lock->donee = lock->holder;
+    }
+}
+
+/*! Makes the current thread, which now holds LOCK, receive the
+    priorities of the threads still waiting for it.  Interrupts must
+    be off. */
+static void lock_take_donations(struct lock *lock) {
+    struct thread *cur = thread_current();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(lock->holder == cur);
+
+    if (wait_queue_empty(&lock->waiters))
+        return;
+
+    lock->donated_priority = wait_queue_max_priority(&lock->waiters);
+    lock_list_add(lock);
+    if (lock->donated_priority > cur->effective_priority) {
+        cur->effective_priority = lock->donated_priority;
+        thread_requeue(cur);
+    }
 }
 
 /*! Acquires LOCK, sleeping until it becomes available if
@@ -203,17 +454,43 @@ void lock_acquire(struct lock *lock) {
     ASSERT(!lock_held_by_current_thread(lock));
 
     struct thread *cur = thread_current();
-    
+    enum intr_level old_level;
+    uint64_t start;
+
+    /* Fast path: the lock is free. */
+    if (__sync_bool_compare_and_swap(&lock->holder, NULL, cur)) {
+        /* Waiters left behind by a release we raced with still
+           donate to us. */
+        if (!wait_queue_empty(&lock->waiters)) {
+            old_level = intr_disable();
+            lock_take_donations(lock);
+            intr_set_level(old_level);
+        }
+        if (lock->profile != NULL)
+            lock_profile_acquired(lock, __builtin_return_address(0),
+                                  false, 0);
+        return;
+    }
 
-    if (compute_priority(cur) > lock->donated_priority) { 
-        lock_donate_priority(lock, compute_priority(cur));
+    start = lock->profile != NULL ? tsc_read() : 0;
+    old_level = intr_disable();
+    while (lock->holder != cur) {
+        if (lock->holder == NULL) {
+            lock->holder = cur;
+            break;
+        }
+        cur->lock_waiting = lock;
+        lock_donate_priority(lock, cur->effective_priority);
+        /* lock_release() hands the lock over before waking us. */
+        wait_queue_wait(&lock->waiters);
     }
-    cur->lock_waiting = lock;
-    sema_down(&lock->semaphore);
     cur->lock_waiting = NULL;
-    lock->holder = cur;
-    /* TODO: recompute lock donation priority */
-    list_push_back(&cur->lock_list, &lock->elem);
+    lock_take_donations(lock);
+    intr_set_level(old_level);
+
+    if (lock->profile != NULL)
+        lock_profile_acquired(lock, __builtin_return_address(0),
+                              true, tsc_read() - start);
 }
 
 /*! Tries to acquires LOCK and returns true if successful or false
@@ -223,32 +500,70 @@ void lock_acquire(struct lock *lock) {
     This function will not sleep, so it may be called within an
     interrupt handler. */
 bool lock_try_acquire(struct lock *lock) {
-    bool success;
+    enum intr_level old_level;
 
     ASSERT(lock != NULL);
     ASSERT(!lock_held_by_current_thread(lock));
 
-    success = sema_try_down(&lock->semaphore);
-    if (success)
-      lock->holder = thread_current();
+    if (!__sync_bool_compare_and_swap(&lock->holder, NULL, thread_current()))
+        return false;
 
-    return success;
+    if (!wait_queue_empty(&lock->waiters)) {
+        old_level = intr_disable();
+        lock_take_donations(lock);
+        intr_set_level(old_level);
+    }
+    if (lock->profile != NULL)
+        lock_profile_acquired(lock, __builtin_return_address(0), false, 0);
+    return true;
 }
 
 /*! Releases LOCK, which must be owned by the current thread.
+    Yields only if this lets a higher-priority thread run.
 
     An interrupt handler cannot acquire a lock, so it does not
     make sense to try to release a lock within an interrupt
     handler. */
 void lock_release(struct lock *lock) {
+    struct thread *cur = thread_current();
+    struct thread *next;
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
 
-    lock->holder = NULL;
-    lock->donated_priority = PRI_MIN;
-    list_remove(&lock->elem);
-    sema_up(&lock->semaphore);
-    thread_yield();
+    if (lock->profile != NULL)
+        lock_profile_released(lock);
+
+    /* Fast path: no thread has queued up on the lock.  A waiter that
+       arrives just before the store below is caught by the check
+       after it, and one that arrives after it finds the lock free. */
+    if (lock->donee != cur) {
+        lock->holder = NULL;
+        barrier();
+        if (wait_queue_empty(&lock->waiters))
+            return;
+    }
+
+    old_level = intr_disable();
+    if (lock->donee == cur) {
+        list_remove(&lock->elem);
+        lock->donee = NULL;
+        lock->donated_priority = PRI_MIN;
+    }
+    thread_recompute_priority(cur);
+
+    /* Hand the lock to the first waiter, unless some thread took it
+       after the fast path let go of it. */
+    next = NULL;
+    if (lock->holder == cur || lock->holder == NULL) {
+        next = wait_queue_wake(&lock->waiters);
+        lock->holder = next;
+    }
+    intr_set_level(old_level);
+
+    if (next != NULL)
+        thread_yield_to_higher();
 }
 
 /*! Returns true if the current thread holds LOCK, false
@@ -260,19 +575,43 @@ bool lock_held_by_current_thread(const struct lock *lock) {
     return lock->holder == thread_current();
 }
 
+/*! Donates PRIORITY to L's holder, and onward along the chain of locks
+    that the holder is itself waiting for, stopping as soon as a holder
+    already runs at PRIORITY or higher.  Interrupts must be off. */
 void lock_donate_priority(struct lock *l, int priority) {
-    l->donated_priority = priority;
+    ASSERT(intr_get_level() == INTR_OFF);
+
     struct thread *holder = l->holder;
-    if (holder != NULL && holder->lock_waiting != NULL && holder->lock_waiting->donated_priority < priority) {
-        lock_donate_priority(holder->lock_waiting, priority);
-    }
+    if (holder == NULL)
+        return;
+
+    /* The holder must now take the slow path to release L. */
+    lock_list_add(l);
+    if (l->donated_priority < priority)
+        l->donated_priority = priority;
+
+    thread_donate(holder, priority);
+}
+
+/*! Raises T's effective priority to PRIORITY, unless it is already
+    that high, and passes the donation on to whatever T is waiting
+    for.  Interrupts must be off. */
+static void thread_donate(struct thread *t, int priority) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (t->effective_priority >= priority)
+        return;
+
+    t->effective_priority = priority;
+    /* A preempted thread must move up in the run queue, and a blocked
+       one in the queue it waits on. */
+    thread_requeue(t);
+    wait_queue_reorder(t);
+    if (t->lock_waiting != NULL)
+        lock_donate_priority(t->lock_waiting, priority);
+    else if (t->rwlock_draining != NULL)
+        rwlock_donate_readers(t->rwlock_draining, priority);
 }
-/*! One semaphore in a list. */
-struct semaphore_elem {
-    struct list_elem elem;              /*!< List element. */
-    struct semaphore semaphore;         /*!< This semaphore. */
-    struct thread *thread;              /*!< Associated thread. */
-};
 
 /*! Initializes condition variable COND.  A condition variable
     allows one piece of code to signal a condition and cooperating
@@ -280,7 +619,7 @@ struct semaphore_elem {
 void cond_init(struct condition *cond) {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    wait_queue_init(&cond->waiters);
 }
 
 /*! Atomically releases LOCK and waits for COND to be signaled by
@@ -304,18 +643,21 @@ void cond_init(struct condition *cond) {
     interrupts disabled, but interrupts will be turned back on if
     we need to sleep. */
 void cond_wait(struct condition *cond, struct lock *lock) {
-    struct semaphore_elem waiter;
+    struct waiter waiter;
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
-  
-    waiter.thread = thread_current();
-    sema_init(&waiter.semaphore, 0);
-    list_push_back(&cond->waiters, &waiter.elem);
+
+    /* Enqueue before releasing LOCK so that a signal sent in between
+       is not lost; wait_queue_block() then returns at once. */
+    old_level = intr_disable();
+    wait_queue_push(&cond->waiters, &waiter);
     lock_release(lock);
-    sema_down(&waiter.semaphore);
+    wait_queue_block(&waiter);
+    intr_set_level(old_level);
     lock_acquire(lock);
 }
 
@@ -332,29 +674,9 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED) {
     ASSERT(!intr_context ());
     ASSERT(lock_held_by_current_thread (lock));
 
-    if (!list_empty(&cond->waiters)) {
-        struct list_elem *e = list_begin(&cond->waiters);
-        struct semaphore_elem *sema_elem = list_entry(e, 
-                                           struct semaphore_elem, elem);
-        int max_priority = compute_priority(sema_elem->thread);
-
-        for (e = list_next(e); e != list_end(&cond->waiters); 
-             e = list_next(e)) { 
-            struct semaphore_elem *cur = list_entry(e, 
-                                         struct semaphore_elem, elem);
-            struct thread *t = cur->thread;
-            int priority = compute_priority(t);
-            if (priority > max_priority) { 
-                max_priority = priority;
-                sema_elem = cur;
-            }
-        }
-
-        list_remove(&sema_elem->elem);
-        sema_up(&sema_elem->semaphore);
-
-    }
-
+    enum intr_level old_level = intr_disable();
+    wait_queue_wake(&cond->waiters);
+    intr_set_level(old_level);
 }
 
 /*! Wakes up all threads, if any, waiting on COND (protected by
@@ -367,7 +689,126 @@ void cond_broadcast(struct condition *cond, struct lock *lock) {
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
 
-    while (!list_empty(&cond->waiters))
+    while (!wait_queue_empty(&cond->waiters))
         cond_signal(cond, lock);
 }
 
+/*! Initializes RW, a reader-writer lock. */
+void rwlock_init(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    lock_init(&rw->lock);
+    rw->readers = 0;
+    wait_queue_init(&rw->drained);
+    memset(rw->reader_threads, 0, sizeof rw->reader_threads);
+}
+
+/*! Acquires RW for reading, sleeping while a writer holds it or is
+    waiting for it.
+
+    This function may sleep, so it must not be called within an
+    interrupt handler. */
+void rwlock_read_acquire(struct rwlock *rw) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int i;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    lock_acquire(&rw->lock);
+    old_level = intr_disable();
+    rw->readers++;
+    cur->read_holds++;
+    for (i = 0; i < RWLOCK_READERS; i++)
+        if (rw->reader_threads[i] == NULL) {
+            rw->reader_threads[i] = cur;
+            break;
+        }
+    intr_set_level(old_level);
+    lock_release(&rw->lock);
+}
+
+/*! Releases RW, which the current thread holds for reading.  The last
+    reader out lets a waiting writer in.  A reader that holds no more
+    rwlocks for reading gives back any priority donated by writers. */
+void rwlock_read_release(struct rwlock *rw) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    struct thread *writer = NULL;
+    bool lowered = false;
+    int i;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    ASSERT(rw->readers > 0);
+    ASSERT(cur->read_holds > 0);
+    for (i = 0; i < RWLOCK_READERS; i++)
+        if (rw->reader_threads[i] == cur) {
+            rw->reader_threads[i] = NULL;
+            break;
+        }
+    if (--cur->read_holds == 0 && cur->read_donation != PRI_MIN) {
+        cur->read_donation = PRI_MIN;
+        thread_recompute_priority(cur);
+        lowered = true;
+    }
+    if (--rw->readers == 0)
+        writer = wait_queue_wake(&rw->drained);
+    intr_set_level(old_level);
+
+    if (writer != NULL || lowered)
+        thread_yield_to_higher();
+}
+
+/*! Acquires RW for writing, sleeping until no other thread holds it.
+
+    This function may sleep, so it must not be called within an
+    interrupt handler. */
+void rwlock_write_acquire(struct rwlock *rw) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    /* Holding the lock keeps new readers out while the current ones
+       drain.  They run with our priority until they are gone, as a
+       lock holder would. */
+    lock_acquire(&rw->lock);
+    old_level = intr_disable();
+    cur->rwlock_draining = rw;
+    while (rw->readers > 0) {
+        rwlock_donate_readers(rw, cur->effective_priority);
+        wait_queue_wait(&rw->drained);
+    }
+    cur->rwlock_draining = NULL;
+    intr_set_level(old_level);
+}
+
+/*! Donates PRIORITY to the readers of RW that it keeps track of.
+    Interrupts must be off. */
+static void rwlock_donate_readers(struct rwlock *rw, int priority) {
+    int i;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    for (i = 0; i < RWLOCK_READERS; i++) {
+        struct thread *t = rw->reader_threads[i];
+        if (t != NULL) {
+            if (t->read_donation < priority)
+                t->read_donation = priority;
+            thread_donate(t, priority);
+        }
+    }
+}
+
+/*! Releases RW, which the current thread holds for writing. */
+void rwlock_write_release(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+    ASSERT(lock_held_by_current_thread(&rw->lock));
+
+    lock_release(&rw->lock);
+}
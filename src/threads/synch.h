@@ -9,11 +9,36 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+/*! A queue of blocked threads, kept sorted by effective priority
+    (highest first, FIFO among equals) so that the thread to wake is
+    always at the front. */
+struct wait_queue {
+    struct list waiters;        /*!< List of struct waiter. */
+};
+
+/*! One blocked thread's entry in a wait queue.  Lives on the waiting
+    thread's stack for as long as it sleeps. */
+struct waiter {
+    struct list_elem elem;      /*!< List element in QUEUE's waiters. */
+    struct thread *thread;      /*!< The waiting thread. */
+    struct wait_queue *queue;   /*!< Queue waited on, or NULL once woken. */
+};
+
+void wait_queue_init(struct wait_queue *);
+bool wait_queue_empty(struct wait_queue *);
+void wait_queue_push(struct wait_queue *, struct waiter *);
+void wait_queue_block(struct waiter *);
+void wait_queue_wait(struct wait_queue *);
+struct thread *wait_queue_wake(struct wait_queue *);
+int wait_queue_max_priority(struct wait_queue *);
+void wait_queue_reorder(struct thread *);
 
 /*! A counting semaphore. */
 struct semaphore {
     unsigned value;             /*!< Current value. */
-    struct list waiters;        /*!< List of waiting threads. */
+    struct wait_queue waiters;  /*!< Waiting threads. */
 };
 
 void sema_init(struct semaphore *, unsigned value);
@@ -24,23 +49,63 @@ void sema_self_test(void);
 
 /*! Lock. */
 struct lock {
-    struct thread *holder;      /*!< Thread holding lock (for debugging). */
-    struct semaphore semaphore; /*!< Binary semaphore controlling access. */
-    
-    int donated_priority;
-    struct list_elem elem; 
+    struct thread *holder;      /*!< Thread holding lock, or NULL. */
+    struct wait_queue waiters;  /*!< Threads waiting for the lock. */
+
+    int donated_priority;       /*!< Highest priority of waiters. */
+    struct thread *donee;       /*!< Thread whose lock_list has ELEM. */
+    struct list_elem elem;      /*!< Element in DONEE's lock_list. */
+
+    struct lock_profile *profile; /*!< Statistics, or NULL if none. */
 };
 
+/*! Number of call sites a lock profile tracks waiters for. */
+#define LOCK_PROFILE_SITES 4
+
+/*! Contention statistics for one lock, kept only for locks passed to
+    lock_profile().  Times are in TSC cycles.  Updated only by the
+    lock's holder, so the lock itself protects them. */
+struct lock_profile {
+    char name[16];                      /*!< Name, for the report. */
+    struct list_elem elem;              /*!< In the list of profiles. */
+    unsigned long long acquisitions;    /*!< Times acquired. */
+    unsigned long long contended;       /*!< Times a thread had to wait. */
+    uint64_t wait_cycles;               /*!< Total time spent waiting. */
+    uint64_t max_wait_cycles;           /*!< Longest wait. */
+    uint64_t hold_cycles;               /*!< Total time held. */
+    uint64_t max_hold_cycles;           /*!< Longest hold. */
+    uint64_t acquired_at;               /*!< When the holder got it. */
+
+    /*! The callers of lock_acquire() that waited longest in total. */
+    struct lock_site {
+        void *caller;                   /*!< Return address, or NULL. */
+        unsigned long long waits;       /*!< Times it waited. */
+        uint64_t wait_cycles;           /*!< Total time it waited. */
+    } sites[LOCK_PROFILE_SITES];
+};
+
+/*! Initializer for a lock named NAME, for locks with static storage
+    duration.  The donated priority starts out as PRI_MIN, which is 0. */
+#define LOCK_INITIALIZER(NAME) \
+    { .waiters = { LIST_INITIALIZER((NAME).waiters.waiters) } }
+
 void lock_init(struct lock *);
 void lock_acquire(struct lock *);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_held_by_current_thread(const struct lock *);
 void lock_donate_priority(struct lock *l, int priority);
+/*! If true, lock_profile() attaches profiles and lock_print_stats()
+    reports them.  Controlled by kernel command-line option
+    "-lockprof". */
+extern bool lock_profiling;
+
+void lock_profile(struct lock *, struct lock_profile *, const char *name);
+void lock_print_stats(void);
 
 /*! Condition variable. */
 struct condition {
-    struct list waiters;        /*!< List of waiting threads. */
+    struct wait_queue waiters;  /*!< Waiting threads. */
 };
 
 void cond_init(struct condition *);
@@ -48,6 +113,40 @@ void cond_wait(struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
 
+/*! Number of readers of an rwlock that a writer can donate to. */
+#define RWLOCK_READERS 8
+
+/*! Reader-writer lock.  Any number of readers may hold it at once,
+    or a single writer.  Writers take precedence: once a writer is
+    waiting, new readers wait behind it.
+
+    A writer holds LOCK for as long as it holds the rwlock, so threads
+    waiting for the rwlock donate their priority to it.  Readers hold
+    LOCK only long enough to register themselves.  A writer waiting for
+    the readers to leave donates in turn to the first RWLOCK_READERS of
+    them, which keep the donation until they hold no rwlock for
+    reading. */
+struct rwlock {
+    struct lock lock;           /*!< Held by the writer, or a new reader. */
+    unsigned readers;           /*!< Number of readers holding the rwlock. */
+    struct wait_queue drained;  /*!< Writer waiting for readers to leave. */
+    struct thread *reader_threads[RWLOCK_READERS];
+                                /*!< Readers that receive donations, or
+                                     NULL for an empty slot. */
+};
+
+/*! Initializer for an rwlock named NAME, for rwlocks with static
+    storage duration. */
+#define RWLOCK_INITIALIZER(NAME) \
+    { .lock = LOCK_INITIALIZER((NAME).lock), \
+      .drained = { LIST_INITIALIZER((NAME).drained.waiters) } }
+
+void rwlock_init(struct rwlock *);
+void rwlock_read_acquire(struct rwlock *);
+void rwlock_read_release(struct rwlock *);
+void rwlock_write_acquire(struct rwlock *);
+void rwlock_write_release(struct rwlock *);
+
 /*! Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -55,5 +154,58 @@ void cond_broadcast(struct condition *, struct lock *);
    reference guide for more information.*/
 #define barrier() asm volatile ("" : : : "memory")
 
+/*! Sequence lock, for small values that are read far more often than
+    they are written and that readers can simply read again.  A reader
+    never blocks the writer.  Instead, it retries if a write happened
+    while it was reading:
+
+        do {
+            seq = seqlock_read_begin(&sl);
+            ...copy the protected value...
+        } while (seqlock_read_retry(&sl, seq));
+
+    Writers must run with interrupts off, so that a reader can only
+    ever see a write in progress by interrupting it. */
+struct seqlock {
+    unsigned seq;               /*!< Odd while a write is in progress. */
+};
+
+/*! Initializer for a seqlock. */
+#define SEQLOCK_INITIALIZER { 0 }
+
+/*! Initializes seqlock SL. */
+static inline void seqlock_init(struct seqlock *sl) {
+    sl->seq = 0;
+}
+
+/*! Starts a read of the value protected by SL and returns the sequence
+    number to pass to seqlock_read_retry(). */
+static inline unsigned seqlock_read_begin(const struct seqlock *sl) {
+    unsigned seq = sl->seq;
+    barrier();
+    return seq;
+}
+
+/*! Returns true if the value read since seqlock_read_begin() returned
+    SEQ may be torn, so that the read must be repeated. */
+static inline bool seqlock_read_retry(const struct seqlock *sl,
+                                      unsigned seq) {
+    barrier();
+    return (seq & 1) != 0 || sl->seq != seq;
+}
+
+/*! Starts a write of the value protected by SL.  Interrupts must be
+    off. */
+static inline void seqlock_write_begin(struct seqlock *sl) {
+    sl->seq++;
+    barrier();
+}
+
+/*! Ends a write of the value protected by SL. */
+static inline void seqlock_write_end(struct seqlock *sl) {
+    barrier();
+    sl->seq++;
+}
+
 #endif /* threads/synch.h */
 
@@ -2,16 +2,22 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/spinlock.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "threads/fixed-point.h"
+#include "devices/timer.h"
+#include "devices/tsc.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -21,9 +27,35 @@
     of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/*! List of processes in THREAD_READY state, that is, processes
-    that are ready to run but not actually running. */
-static struct list ready_list;
+/*! A CPU's run queue of processes in THREAD_READY state, that is,
+    processes that are ready to run but not actually running.  There is
+    one FIFO per priority level, and bit P of BITMAP is set iff QUEUES[P]
+    is nonempty, so the highest nonempty level can be found with a
+    find-first-set instead of a scan.
+
+    Threads of the earliest-deadline-first class that have budget left
+    come before all of these, in EDF_QUEUE, sorted by deadline.
+
+    Under the stride scheduler the levels are unused.  Ready threads are
+    kept instead in a leftist heap ordered by pass, so that the thread
+    furthest behind its share is found and removed in O(log n).
+
+    All run queue state is reached through this_rq() and changed under
+    LOCK, rather than by relying on interrupts being off, so that each
+    CPU can have a run queue of its own.  Only the boot CPU is brought
+    up today, so there is exactly one. */
+struct runqueue {
+    struct spinlock lock;               /*!< Protects the members below. */
+    struct list queues[PRI_MAX + 1];    /*!< One FIFO per priority. */
+    uint64_t bitmap;                    /*!< Nonempty levels. */
+    int count;                          /*!< # of threads in the queue. */
+    struct list edf_queue;              /*!< EDF threads, by deadline. */
+    struct thread *pass_heap;           /*!< Stride: lowest pass on top. */
+    uint64_t pass_now;                  /*!< Stride: pass of last thread
+                                             chosen to run. */
+};
+
+static struct runqueue boot_rq;         /*!< The boot CPU's run queue. */
 
 /*! List of all processes.  Processes are added to this list
     when they are first scheduled and removed when they exit. */
@@ -38,6 +70,41 @@ static struct thread *initial_thread;
 /*! Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/*! Number of buckets in the tid table.  Tids are handed out in order,
+    so their low bits spread threads evenly over the buckets. */
+#define TID_BUCKETS 256
+
+/*! A thread's entry in the tid table.  It is created along with the
+    thread and outlives it to hold its exit status, until the parent
+    collects that with thread_wait() or exits itself. */
+struct tid_entry {
+    tid_t tid;                  /*!< Thread identifier. */
+    struct list_elem elem;      /*!< Element in a tid_table bucket. */
+    struct thread *thread;      /*!< The thread, or NULL once exited. */
+    struct thread *parent;      /*!< Creator, or NULL once it exited. */
+    struct list_elem childelem; /*!< Element in parent's children. */
+    int status;                 /*!< Exit status. */
+    struct semaphore dead;      /*!< Upped when the thread exits. */
+};
+
+/*! Live threads and exited threads whose status has not been collected,
+    hashed by tid.  Changed only with interrupts off, so that it can be
+    read from the scheduler and interrupt handlers. */
+static struct list tid_table[TID_BUCKETS];
+
+/*! The initial thread's entry, which cannot come from malloc(). */
+static struct tid_entry initial_tid_entry;
+
+/*! Pages of threads that have exited, kept for reuse by thread_create()
+    so that spawning a thread does not go through the page allocator.
+    init_thread() and alloc_frame() clear the parts of a page that a new
+    thread relies on, so a recycled page is not zeroed.  The page
+    allocator empties the cache through thread_release_pages() when it
+    runs out of pages.  Accessed with interrupts off. */
+#define THREAD_PAGE_CACHE_SIZE 16
+static void *thread_page_cache[THREAD_PAGE_CACHE_SIZE];
+static int thread_page_cache_cnt;
+
 /*! Stack frame for kernel_thread(). */
 struct kernel_thread_frame {
     void *eip;                  /*!< Return address. */
@@ -50,6 +117,59 @@ static long long idle_ticks;    /*!< # of timer ticks spent idle. */
 static long long kernel_ticks;  /*!< # of timer ticks in kernel threads. */
 static long long user_ticks;    /*!< # of timer ticks in user programs. */
 
+/*! CPU accounting folded in from threads that have exited. */
+static struct {
+    unsigned threads;                   /*!< # of threads. */
+    uint64_t run_cycles;                /*!< Their total running time. */
+    uint64_t ready_cycles;              /*!< Their total ready time. */
+    uint64_t blocked_cycles;            /*!< Their total blocked time. */
+    unsigned long long voluntary_switches;
+    unsigned long long involuntary_switches;
+    unsigned long long edf_jobs;        /*!< Their EDF jobs released. */
+    unsigned long long edf_misses;      /*!< Their EDF jobs that were late. */
+} exited_stats;
+
+/*! Most threads thread_print_stats() lists individually. */
+#define THREAD_STATS_MAX 32
+
+/*! Wakeup latency, from thread_unblock() until the thread runs, by the
+    priority the thread was queued at, in bands of LATENCY_BAND_SIZE
+    levels (EDF threads count in the top band).  Bucket 0 counts
+    latencies under 1 us, and bucket B > 0 those from 2**(B-1) up to
+    2**B us, with the last bucket open-ended. */
+#define LATENCY_BAND_SIZE 8
+#define LATENCY_BANDS ((PRI_MAX + 1) / LATENCY_BAND_SIZE)
+#define LATENCY_BUCKETS 16
+static unsigned wakeup_latency[LATENCY_BANDS][LATENCY_BUCKETS];
+
+/*! How much of TIME_SLICE each time slice used before the thread gave up
+    the CPU, in tenths, with the last bucket for slices that ran to the
+    end or beyond. */
+#define SLICE_BUCKETS 11
+static unsigned slice_use[SLICE_BUCKETS];
+
+/*! Why a thread switch happened. */
+enum switch_reason {
+    SWITCH_BLOCK,               /*!< Previous thread blocked. */
+    SWITCH_YIELD,               /*!< Previous thread yielded or was
+                                     preempted. */
+    SWITCH_EXIT                 /*!< Previous thread exited. */
+};
+
+/*! One thread switch, as kept in the switch log. */
+struct switch_record {
+    uint64_t when;              /*!< TSC at the switch. */
+    tid_t prev;                 /*!< Thread switched from. */
+    tid_t next;                 /*!< Thread switched to. */
+    enum switch_reason reason;  /*!< Why. */
+};
+
+/*! Ring buffer of the most recent thread switches, for
+    thread_print_switches().  Accessed with interrupts off. */
+#define SWITCH_LOG_SIZE 32
+static struct switch_record switch_log[SWITCH_LOG_SIZE];
+static unsigned switch_cnt;     /*!< # of switches ever logged. */
+
 /* Scheduling. */
 #define TIME_SLICE 4            /*!< # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /*!< # of timer ticks since last yield. */
@@ -59,9 +179,46 @@ static unsigned thread_ticks;   /*!< # of timer ticks since last yield. */
     Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/*! If true, use the stride scheduler.  Controlled by "-stride". */
+bool thread_stride;
+
+/*! Pass a thread with a single ticket advances by per tick it runs.  A
+    thread with N tickets advances by STRIDE_ONE / N. */
+#define STRIDE_ONE (1 << 20)
+
+/*! Run queue level of a ready thread in the EDF class, above any
+    priority. */
+#define PRI_EDF (PRI_MAX + 1)
+
+/*! EDF admission control.  The densities runtime / deadline of all EDF
+    threads, in thousandths, may add up to at most EDF_DENSITY_MAX, which
+    leaves some CPU for everybody else. */
+#define EDF_DENSITY_ONE 1000
+#define EDF_DENSITY_MAX 900
+static int edf_density;         /*!< Sum of admitted densities. */
+
+/*! EDF threads that used up their budget, in order of next release.
+    edf_tick() moves each back to the EDF class when its period ends,
+    since one that is ready at a low priority might otherwise not run
+    again to notice. */
+static struct list edf_demoted;
+
 /*! Average load for BSD scheduler. */
 static fixed_F load_avg;
 
+/*! Number of once-per-second recent_cpu decays so far, and the decay
+    coefficient used by each of the last DECAY_HISTORY of them.  The
+    running thread is decayed on the spot.  Ready threads are decayed by
+    mlfqs_sweep_work right after the timer interrupt, since their
+    priorities decide who runs next.  Blocked threads are not;
+    thread_unblock() replays the decays they missed, starting from their
+    decay_epoch, or from the steady state if they missed too many; see
+    mlfqs_refresh(). */
+#define DECAY_HISTORY 64
+static int decay_epoch;
+static fixed_F decay_history[DECAY_HISTORY];
+static struct work mlfqs_sweep_work;
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
@@ -73,13 +230,42 @@ static void *alloc_frame(struct thread *, size_t size);
 static void schedule(void);
 void thread_schedule_tail(struct thread *prev);
 static tid_t allocate_tid(void);
+static void tid_insert(struct tid_entry *, struct thread *,
+                       struct thread *parent);
+static struct tid_entry *tid_find(tid_t);
+static void *thread_page_get(void);
+static void thread_page_put(struct thread *);
+static struct runqueue *this_rq(void);
+static void ready_push(struct thread *);
+static void ready_remove(struct thread *);
+static int ready_max_priority(void);
+static void mlfqs_tick(struct thread *cur);
+static void mlfqs_refresh(struct thread *t);
+static int bsd_priority(struct thread *t);
+static void update_load_avg(void);
+static void update_recent_cpus(void);
+static void mlfqs_sweep(void *aux);
+static struct thread *pass_merge(struct thread *, struct thread *);
+static int edf_density_of(struct thread *);
+static bool edf_runnable(struct thread *);
+static bool edf_refresh(struct thread *, int64_t now);
+static bool edf_is_demoted(struct thread *);
+static void edf_rerelease(int64_t now);
+static bool edf_release_less(const struct list_elem *,
+                             const struct list_elem *, void *aux);
+static void edf_tick(struct thread *cur);
+static void trace_switch(struct thread *cur, struct thread *next,
+                         uint64_t now);
+static void trace_wakeup(struct thread *cur, uint64_t now);
+static bool edf_less(const struct list_elem *, const struct list_elem *,
+                     void *aux);
 
 /*! Initializes the threading system by transforming the code
     that's currently running into a thread.  This can't work in
     general and it is possible in this case only because loader.S
     was careful to put the bottom of the stack at a page boundary.
 
-    Also initializes the run queue and the tid lock.
+    Also initializes the run queue, the tid lock and the tid table.
 
     After calling this function, be sure to initialize the page allocator
     before trying to create any threads with thread_create().
@@ -88,17 +274,31 @@ static tid_t allocate_tid(void);
 void thread_init(void) {
     ASSERT(intr_get_level() == INTR_OFF);
 
+    int pri, i;
+
     lock_init(&tid_lock);
-    list_init(&ready_list);
+    spinlock_init(&boot_rq.lock);
+    for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+        list_init(&boot_rq.queues[pri]);
+    boot_rq.bitmap = 0;
+    boot_rq.count = 0;
+    list_init(&boot_rq.edf_queue);
+    boot_rq.pass_heap = NULL;
+    boot_rq.pass_now = 0;
+    list_init(&edf_demoted);
     list_init(&all_list);
+    for (i = 0; i < TID_BUCKETS; i++)
+        list_init(&tid_table[i]);
 
     load_avg = fixed_point(0);
+    work_init(&mlfqs_sweep_work, mlfqs_sweep, NULL);
 
     /* Set up a thread structure for the running thread. */
     initial_thread = running_thread();
     init_thread(initial_thread, "main", PRI_DEFAULT);
     initial_thread->status = THREAD_RUNNING;
     initial_thread->tid = allocate_tid();
+    tid_insert(&initial_tid_entry, initial_thread, NULL);
 }
 
 
@@ -133,15 +333,147 @@ void thread_tick(void) {
     else
         kernel_ticks++;
 
+    if (thread_mlfqs)
+        mlfqs_tick(t);
+    else if (thread_stride && t != idle_thread)
+        t->pass += t->stride;
+    edf_tick(t);
+
     /* Enforce preemption. */
     if (++thread_ticks >= TIME_SLICE)
         intr_yield_on_return();
 }
 
+/*! Accounts for a timer tick that passed while the idle thread slept
+    with the periodic tick stopped.  Called by the timer with interrupts
+    off, but not necessarily from the timer interrupt. */
+void thread_idle_tick(void) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    idle_ticks++;
+
+    /* Nothing ran, so only the once-per-second recalculations are due. */
+    if (thread_mlfqs && timer_ticks() % TIMER_FREQ == 0) {
+        update_load_avg();
+        update_recent_cpus();
+    }
+}
+
 /*! Prints thread statistics. */
 void thread_print_stats(void) {
+    static struct {
+        tid_t tid;
+        char name[16];
+        struct thread_stats stats;
+        unsigned edf_jobs;
+        unsigned edf_misses;
+    } snap[THREAD_STATS_MAX];
+    struct list_elem *e;
+    enum intr_level old_level;
+    size_t cnt = 0, total = 0;
+    size_t i;
+
     printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
            idle_ticks, kernel_ticks, user_ticks);
+
+    /* Take a snapshot first, since printing may block and let threads
+       exit out from under the walk. */
+    old_level = intr_disable();
+    for (e = list_begin(&all_list); e != list_end(&all_list);
+         e = list_next(e)) {
+        struct thread *t = list_entry(e, struct thread, allelem);
+
+        if (cnt < THREAD_STATS_MAX) {
+            snap[cnt].tid = t->tid;
+            strlcpy(snap[cnt].name, t->name, sizeof snap[cnt].name);
+            thread_get_stats(t, &snap[cnt].stats);
+            snap[cnt].edf_jobs = t->edf_jobs;
+            snap[cnt].edf_misses = t->edf_misses;
+            cnt++;
+        }
+        total++;
+    }
+    intr_set_level(old_level);
+
+    for (i = 0; i < cnt; i++) {
+        const struct thread_stats *st = &snap[i].stats;
+        printf("Thread %d (%s): %llu us running, %llu us ready, "
+               "%llu us blocked, %u voluntary, %u involuntary switches\n",
+               snap[i].tid, snap[i].name, st->run_ns / 1000,
+               st->ready_ns / 1000, st->blocked_ns / 1000,
+               st->voluntary_switches, st->involuntary_switches);
+        if (snap[i].edf_jobs > 0)
+            printf("Thread %d (%s): %u EDF jobs, %u deadline misses\n",
+                   snap[i].tid, snap[i].name, snap[i].edf_jobs,
+                   snap[i].edf_misses);
+    }
+    if (total > cnt)
+        printf("Thread: %zu more threads not shown\n", total - cnt);
+    if (exited_stats.threads > 0)
+        printf("Thread: %u exited: %llu us running, %llu us ready, "
+               "%llu us blocked, %llu voluntary, %llu involuntary switches\n",
+               exited_stats.threads, tsc_to_us(exited_stats.run_cycles),
+               tsc_to_us(exited_stats.ready_cycles),
+               tsc_to_us(exited_stats.blocked_cycles),
+               exited_stats.voluntary_switches,
+               exited_stats.involuntary_switches);
+    if (exited_stats.edf_jobs > 0)
+        printf("Thread: exited threads had %llu EDF jobs, "
+               "%llu deadline misses\n",
+               exited_stats.edf_jobs, exited_stats.edf_misses);
+
+    /* Only the bands and buckets that saw wakeups are printed. */
+    for (i = 0; i < LATENCY_BANDS; i++) {
+        int b, last = -1;
+
+        for (b = 0; b < LATENCY_BUCKETS; b++)
+            if (wakeup_latency[i][b] != 0)
+                last = b;
+        if (last < 0)
+            continue;
+        printf("Thread: wakeup latency, priority %zu-%zu:",
+               i * LATENCY_BAND_SIZE, (i + 1) * LATENCY_BAND_SIZE - 1);
+        for (b = 0; b <= last; b++) {
+            if (b < LATENCY_BUCKETS - 1)
+                printf(" <%dus %u", 1 << b, wakeup_latency[i][b]);
+            else
+                printf(" more %u", wakeup_latency[i][b]);
+        }
+        printf("\n");
+    }
+
+    printf("Thread: time slice use in tenths of %d ticks:", TIME_SLICE);
+    for (i = 0; i < SLICE_BUCKETS; i++)
+        printf(" %u", slice_use[i]);
+    printf("\n");
+}
+
+/*! Fills in STATS with where thread T's time has gone so far, counting
+    the time T has spent in its current state up to now. */
+void thread_get_stats(struct thread *t, struct thread_stats *stats) {
+    enum intr_level old_level;
+    uint64_t run, ready, blocked, pending;
+
+    ASSERT(is_thread(t));
+
+    old_level = intr_disable();
+    run = t->run_cycles;
+    ready = t->ready_cycles;
+    blocked = t->blocked_cycles;
+    pending = tsc_read() - t->state_since;
+    if (t->status == THREAD_RUNNING)
+        run += pending;
+    else if (t->status == THREAD_READY)
+        ready += pending;
+    else if (t->status == THREAD_BLOCKED)
+        blocked += pending;
+    stats->voluntary_switches = t->voluntary_switches;
+    stats->involuntary_switches = t->involuntary_switches;
+    intr_set_level(old_level);
+
+    stats->run_ns = tsc_to_ns(run);
+    stats->ready_ns = tsc_to_ns(ready);
+    stats->blocked_ns = tsc_to_ns(blocked);
 }
 
 /*! Creates a new kernel thread named NAME with the given initial PRIORITY,
@@ -164,18 +496,26 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     struct kernel_thread_frame *kf;
     struct switch_entry_frame *ef;
     struct switch_threads_frame *sf;
+    struct tid_entry *e;
     tid_t tid;
+    int new_priority;
 
     ASSERT(function != NULL);
 
-    /* Allocate thread. */
-    t = palloc_get_page(PAL_ZERO);
-    if (t == NULL)
+    /* Allocate thread and its tid table entry. */
+    e = malloc(sizeof *e);
+    if (e == NULL)
+        return TID_ERROR;
+    t = thread_page_get();
+    if (t == NULL) {
+        free(e);
         return TID_ERROR;
+    }
 
     /* Initialize thread. */
     init_thread(t, name, priority);
     tid = t->tid = allocate_tid();
+    tid_insert(e, t, thread_current());
 
     /* Stack frame for kernel_thread(). */
     kf = alloc_frame(t, sizeof *kf);
@@ -195,9 +535,11 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     /* 
      * If new thread's priority is greater than
      * the current, yield to schedule the new one. 
+     * (The BSD scheduler computes its own initial priority.)
      */
+    new_priority = t->priority;
     thread_unblock(t);
-    thread_is_top_priority(priority);
+    thread_is_top_priority(new_priority);
     return tid;
 }
 
@@ -222,15 +564,23 @@ void thread_block(void) {
     if the caller had disabled interrupts itself, it may expect that it can
     atomically unblock a thread and update other data. */
 void thread_unblock(struct thread *t) {
+    struct runqueue *rq = this_rq();
     enum intr_level old_level;
+    uint64_t now;
 
     ASSERT(is_thread(t));
 
-    old_level = intr_disable();
+    old_level = spinlock_acquire(&rq->lock);
     ASSERT(t->status == THREAD_BLOCKED);
-    list_push_back(&ready_list, &t->elem);
+    if (thread_mlfqs)
+        mlfqs_refresh(t);
+    ready_push(t);
     t->status = THREAD_READY;
-    intr_set_level(old_level);
+    now = tsc_read();
+    t->blocked_cycles += now - t->state_since;
+    t->state_since = now;
+    t->woken_at = now;
+    spinlock_release(&rq->lock, old_level);
 }
 
 /*! Returns the name of the running thread. */
@@ -263,22 +613,108 @@ tid_t thread_tid(void) {
 /*! Deschedules the current thread and destroys it.  Never
     returns to the caller. */
 void thread_exit(void) {
+    struct thread *cur = thread_current();
+    struct tid_entry *e = cur->tid_entry;
+    enum intr_level old_level;
+    struct list reap;
+
     ASSERT(!intr_context());
 
 #ifdef USERPROG
     process_exit();
 #endif
 
+    /* Orphan our children, dropping the entries of those that have
+       already exited, since nobody can wait for them now.  Then leave
+       our exit status for our parent, or drop our entry if there is
+       no parent left.  The parent may free the entry as soon as DEAD
+       is upped, so that comes last. */
+    list_init(&reap);
+    old_level = intr_disable();
+    while (!list_empty(&cur->children)) {
+        struct tid_entry *child = list_entry(list_pop_front(&cur->children),
+                                             struct tid_entry, childelem);
+        child->parent = NULL;
+        if (child->thread == NULL) {
+            list_remove(&child->elem);
+            list_push_back(&reap, &child->elem);
+        }
+    }
+    e->thread = NULL;
+    if (e->parent == NULL) {
+        list_remove(&e->elem);
+        if (e != &initial_tid_entry)
+            list_push_back(&reap, &e->elem);
+    }
+    else
+        sema_up(&e->dead);
+    intr_set_level(old_level);
+    while (!list_empty(&reap))
+        free(list_entry(list_pop_front(&reap), struct tid_entry, elem));
+
     /* Remove thread from all threads list, set our status to dying,
        and schedule another process.  That process will destroy us
        when it calls thread_schedule_tail(). */
     intr_disable();
+    if (edf_is_demoted(thread_current()))
+        list_remove(&thread_current()->edf_elem);
+    edf_density -= edf_density_of(thread_current());
     list_remove(&thread_current()->allelem);
     thread_current()->status = THREAD_DYING;
     schedule();
     NOT_REACHED();
 }
 
+/*! Waits for thread TID, a child of the running thread, to exit and
+    returns its exit status.  Returns -1 at once if TID is not a child
+    of the running thread or its status has already been collected.
+    Apart from the wait itself, this takes constant time. */
+int thread_wait(tid_t tid) {
+    struct thread *cur = thread_current();
+    struct tid_entry *e;
+    enum intr_level old_level;
+    int status;
+
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    e = tid_find(tid);
+    if (e == NULL || e->parent != cur) {
+        intr_set_level(old_level);
+        return -1;
+    }
+    intr_set_level(old_level);
+
+    sema_down(&e->dead);
+    status = e->status;
+
+    old_level = intr_disable();
+    list_remove(&e->elem);
+    list_remove(&e->childelem);
+    intr_set_level(old_level);
+    free(e);
+    return status;
+}
+
+/*! Sets the status that thread_wait() will return for the running
+    thread once it exits.  A thread that never sets one exits with -1,
+    as if killed. */
+void thread_set_exit_status(int status) {
+    thread_current()->tid_entry->status = status;
+}
+
+/*! Returns the live thread with the given TID, or NULL if there is
+    none.  Interrupts must be off, and the result is only good until
+    they are turned back on. */
+struct thread *thread_lookup(tid_t tid) {
+    struct tid_entry *e;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    e = tid_find(tid);
+    return e != NULL ? e->thread : NULL;
+}
+
 /*! Yields the CPU.  The current thread is not put to sleep and
     may be scheduled again immediately at the scheduler's whim. */
 void thread_yield(void) {
@@ -288,13 +724,33 @@ void thread_yield(void) {
     ASSERT(!intr_context());
 
     old_level = intr_disable();
-    if (cur != idle_thread) 
-        list_push_back(&ready_list, &cur->elem);
+    if (cur != idle_thread) {
+        struct runqueue *rq = this_rq();
+        enum intr_level rq_level = spinlock_acquire(&rq->lock);
+        ready_push(cur);
+        spinlock_release(&rq->lock, rq_level);
+    }
     cur->status = THREAD_READY;
     schedule();
     intr_set_level(old_level);
 }
 
+/*! Yields the CPU if a ready thread has a higher priority than the
+    current thread, so that it runs right away. */
+void thread_yield_to_higher(void) {
+    enum intr_level old_level;
+    bool preempt;
+
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    preempt = ready_max_priority() > compute_priority(thread_current());
+    intr_set_level(old_level);
+
+    if (preempt)
+        thread_yield();
+}
+
 /*! The current thread is put to sleep and must be
     woken up by the timer. */
 void thread_sleep(void) {
@@ -325,18 +781,19 @@ void thread_foreach(thread_action_func *func, void *aux) {
 
 /*! Sets the current thread's priority to NEW_PRIORITY. */
 void thread_set_priority(int new_priority) {
-    thread_current()->priority = new_priority;
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int ready_max;
 
-    if(!list_empty(&ready_list)) {
+    old_level = intr_disable();
+    cur->priority = new_priority;
+    thread_recompute_priority(cur);
+    ready_max = ready_max_priority();
+    intr_set_level(old_level);
 
-        struct list_elem *e = list_max(&ready_list, &priority_less, NULL);
-        struct thread *t = list_entry(e, struct thread, elem);
-        
-        /* Yield if the ready list has a thread with higher priority. */
-        if (new_priority < compute_priority(t)) {
-            thread_yield();
-        }
-    }
+    /* Yield if the run queue has a thread with higher priority. */
+    if (compute_priority(cur) < ready_max)
+        thread_yield();
 }
 
 /*! Returns the current thread's priority. */
@@ -344,29 +801,137 @@ int thread_get_priority(void) {
     return compute_priority(thread_current());
 }
 
-/*! Sets the current thread's nice value to NICE. */
-void thread_set_nice(int nice UNUSED) {
-    /* Not yet implemented. */
-    thread_current()->nice = nice;
+/*! Sets the current thread's nice value to NICE, recomputes its
+    priority, and yields if it no longer has the highest priority. */
+void thread_set_nice(int nice) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int ready_max;
+
+    cur->nice = nice;
+    if (!thread_mlfqs)
+        return;
+
+    old_level = intr_disable();
+    cur->priority = bsd_priority(cur);
+    ready_max = ready_max_priority();
+    intr_set_level(old_level);
+
+    if (cur->priority < ready_max)
+        thread_yield();
 }
 
 /*! Returns the current thread's nice value. */
 int thread_get_nice(void) {
-    /* Not yet implemented. */
     return thread_current()->nice;
 }
 
 /*! Returns 100 times the system load average. */
 int thread_get_load_avg(void) {
-    return fixed_to_int(fixed_mult(fixed_point(100), load_avg));
+    return fixed_to_int(fixed_mult_int(load_avg, 100));
 }
 
 /*! Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void) {
-    return fixed_to_int(fixed_mult(fixed_point(100), 
-                                   thread_current()->recent_cpu));
+    return fixed_to_int(fixed_mult_int(thread_current()->recent_cpu, 100));
 }
 
+/*! Sets the current thread's stride scheduler tickets to TICKETS, which
+    must be between TICKETS_MIN and TICKETS_MAX.  The new share applies
+    from the next timer tick on. */
+void thread_set_tickets(int tickets) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+
+    old_level = intr_disable();
+    cur->tickets = tickets;
+    cur->stride = STRIDE_ONE / tickets;
+    intr_set_level(old_level);
+}
+
+/*! Returns the current thread's stride scheduler tickets. */
+int thread_get_tickets(void) {
+    return thread_current()->tickets;
+}
+
+/*! Puts the current thread in the earliest-deadline-first class, which
+    runs ahead of all priorities.  Every PERIOD ticks, starting now, the
+    thread is released a job that may use up to RUNTIME ticks of CPU and
+    should be finished, by calling thread_wait_period(), within DEADLINE
+    ticks.  A thread that uses up RUNTIME drops back to its normal
+    priority until its next period.
+
+    Returns false, and changes nothing, if admitting the thread would
+    overcommit the CPU.  A RUNTIME of 0 takes the thread out of the EDF
+    class, which always succeeds. */
+bool thread_set_deadline(int64_t runtime, int64_t period, int64_t deadline) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int density = 0;
+    bool ok = false;
+
+    ASSERT(!intr_context());
+    if (runtime != 0) {
+        ASSERT(0 < runtime && runtime <= deadline && deadline <= period);
+        density = DIV_ROUND_UP(runtime * EDF_DENSITY_ONE, deadline);
+    }
+
+    old_level = intr_disable();
+    if (edf_density - edf_density_of(cur) + density <= EDF_DENSITY_MAX) {
+        if (edf_is_demoted(cur))
+            list_remove(&cur->edf_elem);
+        edf_density += density - edf_density_of(cur);
+        cur->edf_runtime = runtime;
+        cur->edf_period = runtime != 0 ? period : 0;
+        cur->edf_rel_deadline = deadline;
+        cur->edf_release = timer_ticks();
+        cur->edf_deadline = cur->edf_release + deadline;
+        cur->edf_budget = runtime;
+        cur->edf_done = false;
+        if (runtime != 0)
+            cur->edf_jobs++;
+        ok = true;
+    }
+    intr_set_level(old_level);
+
+    /* Move to the run queue for our new class. */
+    if (ok)
+        thread_yield();
+    return ok;
+}
+
+/*! Finishes the current thread's EDF job and sleeps until the next one
+    is released.  A job finished after its deadline counts as a miss. */
+void thread_wait_period(void) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int64_t now, next;
+
+    ASSERT(cur->edf_period != 0);
+
+    old_level = intr_disable();
+    now = timer_ticks();
+    if (!cur->edf_done && now > cur->edf_deadline)
+        cur->edf_misses++;
+    cur->edf_done = true;
+    next = cur->edf_release + cur->edf_period;
+    if (next <= now)
+        edf_refresh(cur, now);
+    intr_set_level(old_level);
+
+    /* The wakeup releases the next job; see ready_push(). */
+    if (next > now)
+        timer_sleep(next - now);
+}
+
+/*! Returns the number of the current thread's EDF jobs that missed
+    their deadlines. */
+unsigned thread_get_deadline_misses(void) {
+    return thread_current()->edf_misses;
+}
+
 /*! Idle thread.  Executes when no other thread is ready to run.
 
     The idle thread is initially put on the ready list by thread_start().
@@ -385,6 +950,16 @@ static void idle(void *idle_started_ UNUSED) {
         intr_disable();
         thread_block();
 
+        /* Zero free pages ahead of time while there is nothing else to
+           do.  A thread woken by an interrupt preempts us as usual. */
+        intr_enable();
+        while (palloc_zero_ahead())
+            continue;
+        intr_disable();
+
+        /* Stop the periodic tick if the timer is tickless. */
+        timer_idle_enter();
+
         /* Re-enable interrupts and wait for the next one.
 
            The `sti' instruction disables interrupts until the completion of
@@ -438,9 +1013,29 @@ static void init_thread(struct thread *t, const char *name, int priority) {
     strlcpy(t->name, name, sizeof t->name);
     t->stack = (uint8_t *) t + PGSIZE;
     t->priority = priority;
+    t->effective_priority = priority;
     list_init(&t->lock_list);
+    list_init(&t->children);
+    t->state_since = tsc_read();
+    t->tickets = TICKETS_DEFAULT;
     t->magic = THREAD_MAGIC;
 
+    /* The BSD scheduler ignores PRIORITY.  New threads inherit their
+       parent's nice and recent_cpu and compute their own priority. */
+    t->decay_epoch = decay_epoch;
+    if (thread_mlfqs) {
+        if (t != initial_thread) {
+            t->nice = thread_current()->nice;
+            t->recent_cpu = thread_current()->recent_cpu;
+        }
+        t->priority = bsd_priority(t);
+    }
+
+    /* New threads inherit their parent's share of the CPU. */
+    if (t != initial_thread)
+        t->tickets = thread_current()->tickets;
+    t->stride = STRIDE_ONE / t->tickets;
+
     old_level = intr_disable();
     list_push_back(&all_list, &t->allelem);
     intr_set_level(old_level);
@@ -454,6 +1049,7 @@ static void * alloc_frame(struct thread *t, size_t size) {
     ASSERT(size % sizeof(uint32_t) == 0);
 
     t->stack -= size;
+    memset(t->stack, 0, size);
     return t->stack;
 }
 
@@ -470,18 +1066,295 @@ bool priority_less(const struct list_elem *a,
     thread can continue running, then it will be in the run queue.)  If the
     run queue is empty, return idle_thread. */
 static struct thread * next_thread_to_run(void) {
-    if (list_empty(&ready_list))
-        return idle_thread;
-    /* 
-     * Priority scheduler. 
-     * David's TODO: Implement. 
-     */
-    else {
-        struct list_elem *e = list_max(&ready_list, &priority_less, NULL);
-        list_remove(e);
-        struct thread *t = list_entry(e, struct thread, elem);
-        return t;
+    struct runqueue *rq = this_rq();
+    struct thread *t = idle_thread;
+    enum intr_level old_level;
+
+    old_level = spinlock_acquire(&rq->lock);
+    if (!list_empty(&rq->edf_queue)) {
+        /* EDF class: the earliest deadline. */
+        t = list_entry(list_front(&rq->edf_queue), struct thread, elem);
+        ready_remove(t);
+    }
+    else if (thread_stride) {
+        /* Stride scheduler: the thread with the lowest pass. */
+        t = rq->pass_heap;
+        if (t != NULL) {
+            ready_remove(t);
+            rq->pass_now = t->pass;
+        }
+        else
+            t = idle_thread;
+    }
+    else if (rq->bitmap != 0) {
+        /* Priority scheduler: front of the highest nonempty level, so
+           threads of equal priority run round-robin. */
+        t = list_entry(list_front(&rq->queues[ready_max_priority()]),
+                       struct thread, elem);
+        ready_remove(t);
+    }
+    spinlock_release(&rq->lock, old_level);
+    return t;
+}
+
+/*! Returns the running CPU's run queue. */
+static struct runqueue *this_rq(void) {
+    return &boot_rq;
+}
+
+/*! Appends T to the back of the run queue for its effective priority.
+    The run queue's lock must be held. */
+static void ready_push(struct thread *t) {
+    struct runqueue *rq = this_rq();
+    int pri = compute_priority(t);
+
+    ASSERT(spinlock_held(&rq->lock));
+    ASSERT(PRI_MIN <= pri && pri <= PRI_MAX);
+
+    /* An EDF thread with budget left goes ahead of everyone else.  A new
+       period may have begun while it was away. */
+    if (t->edf_period != 0)
+        edf_refresh(t, timer_ticks());
+    if (edf_runnable(t)) {
+        t->ready_priority = PRI_EDF;
+        list_insert_ordered(&rq->edf_queue, &t->elem, edf_less, NULL);
+        rq->count++;
+        return;
+    }
+
+    t->ready_priority = pri;
+    if (thread_stride) {
+        /* A thread that was blocked gets no credit for the time it did
+           not want the CPU: it rejoins level with the running thread. */
+        if (t->pass < rq->pass_now)
+            t->pass = rq->pass_now;
+        t->pass_left = t->pass_right = NULL;
+        t->pass_rank = 1;
+        rq->pass_heap = pass_merge(rq->pass_heap, t);
+        rq->count++;
+        return;
     }
+    list_push_back(&rq->queues[pri], &t->elem);
+    rq->bitmap |= (uint64_t) 1 << pri;
+    rq->count++;
+}
+
+/*! Removes T from the run queue.  The run queue's lock must be held. */
+static void ready_remove(struct thread *t) {
+    struct runqueue *rq = this_rq();
+    int pri = t->ready_priority;
+
+    ASSERT(spinlock_held(&rq->lock));
+
+    if (pri == PRI_EDF) {
+        list_remove(&t->elem);
+        rq->count--;
+        return;
+    }
+    if (thread_stride) {
+        /* Only the top of the heap is ever taken out. */
+        ASSERT(t == rq->pass_heap);
+        rq->pass_heap = pass_merge(t->pass_left, t->pass_right);
+        rq->count--;
+        return;
+    }
+
+    list_remove(&t->elem);
+    if (list_empty(&rq->queues[pri]))
+        rq->bitmap &= ~((uint64_t) 1 << pri);
+    rq->count--;
+}
+
+/*! Returns the highest priority with a thread in the run queue, or -1 if
+    the run queue is empty.  Without the run queue's lock, the answer is
+    only a snapshot, which is good enough for deciding whether to
+    yield. */
+static int ready_max_priority(void) {
+    struct runqueue *rq = this_rq();
+    uint64_t bitmap = rq->bitmap;
+    uint32_t hi = bitmap >> 32;
+    uint32_t lo = bitmap;
+
+    if (!list_empty(&rq->edf_queue))
+        return PRI_EDF;
+    else if (hi != 0)
+        return 63 - __builtin_clz(hi);
+    else if (lo != 0)
+        return 31 - __builtin_clz(lo);
+    else
+        return -1;
+}
+
+/*! Moves T to the run queue level matching its current effective
+    priority, if T is in the run queue.  Must be called whenever a ready
+    thread's effective priority may have changed, for example by priority
+    donation. */
+void thread_requeue(struct thread *t) {
+    struct runqueue *rq = this_rq();
+    enum intr_level old_level;
+
+    ASSERT(is_thread(t));
+
+    old_level = spinlock_acquire(&rq->lock);
+    if (!thread_stride && t->status == THREAD_READY &&
+        t->ready_priority != PRI_EDF &&
+        t->ready_priority != compute_priority(t)) {
+        ready_remove(t);
+        ready_push(t);
+    }
+    spinlock_release(&rq->lock, old_level);
+}
+
+/*! Returns the rank of leftist heap node T, which is 0 for an empty
+    heap. */
+static inline int pass_rank(struct thread *t) {
+    return t != NULL ? t->pass_rank : 0;
+}
+
+/*! Merges the stride scheduler's run queue heaps rooted at A and B and
+    returns the new root.  The recursion follows right spines, which are
+    O(log n) long in a leftist heap. */
+static struct thread *pass_merge(struct thread *a, struct thread *b) {
+    struct thread *tmp;
+
+    if (a == NULL)
+        return b;
+    if (b == NULL)
+        return a;
+    if (b->pass < a->pass) {
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    a->pass_right = pass_merge(a->pass_right, b);
+    if (pass_rank(a->pass_left) < pass_rank(a->pass_right)) {
+        tmp = a->pass_left;
+        a->pass_left = a->pass_right;
+        a->pass_right = tmp;
+    }
+    a->pass_rank = pass_rank(a->pass_right) + 1;
+    return a;
+}
+
+/*! Returns the share of the CPU, in thousandths, reserved by T for the
+    EDF class. */
+static int edf_density_of(struct thread *t) {
+    if (t->edf_period == 0)
+        return 0;
+    return DIV_ROUND_UP(t->edf_runtime * EDF_DENSITY_ONE,
+                        t->edf_rel_deadline);
+}
+
+/*! Returns true if T should be scheduled in the EDF class, that is, it
+    has asked to be and has budget left in this period. */
+static bool edf_runnable(struct thread *t) {
+    return t->edf_period != 0 && t->edf_budget > 0;
+}
+
+/*! If EDF thread T's period has ended by time NOW, releases its next job
+    with a full budget, and returns true.  A job that was not finished
+    by the end of its period counts as a miss.  Interrupts must be
+    off. */
+static bool edf_refresh(struct thread *t, int64_t now) {
+    int64_t periods;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (t->edf_period == 0 || now < t->edf_release + t->edf_period)
+        return false;
+
+    if (edf_is_demoted(t))
+        list_remove(&t->edf_elem);
+    if (!t->edf_done)
+        t->edf_misses++;
+    periods = (now - t->edf_release) / t->edf_period;
+    t->edf_release += periods * t->edf_period;
+    t->edf_deadline = t->edf_release + t->edf_rel_deadline;
+    t->edf_budget = t->edf_runtime;
+    t->edf_done = false;
+    t->edf_jobs++;
+    return true;
+}
+
+/*! Returns true if T is an EDF thread that has used up its budget for
+    this period, and so is in edf_demoted. */
+static bool edf_is_demoted(struct thread *t) {
+    return t->edf_period != 0 && t->edf_budget == 0;
+}
+
+/*! Releases the next job of each demoted EDF thread whose period has
+    ended by time NOW.  One that is ready moves from its priority level
+    to the EDF queue.  Under the stride scheduler a ready thread can
+    only be taken off the top of the heap, so there it rejoins the EDF
+    class the next time it runs or is queued.  Interrupts must be
+    off. */
+static void edf_rerelease(int64_t now) {
+    while (!list_empty(&edf_demoted)) {
+        struct thread *t = list_entry(list_front(&edf_demoted),
+                                      struct thread, edf_elem);
+        if (now < t->edf_release + t->edf_period)
+            break;
+
+        /* Takes T off edf_demoted. */
+        edf_refresh(t, now);
+        if (t->status == THREAD_READY && !thread_stride) {
+            struct runqueue *rq = this_rq();
+            enum intr_level old_level = spinlock_acquire(&rq->lock);
+            ready_remove(t);
+            ready_push(t);
+            spinlock_release(&rq->lock, old_level);
+        }
+    }
+}
+
+/*! Enforces the EDF class for one timer tick, with CUR running.  CUR is
+    charged the tick against its budget, and is preempted if it ran out,
+    if its next period began, or if an EDF thread with an earlier
+    deadline is ready.  Demoted EDF threads whose next period began are
+    returned to the EDF class. */
+static void edf_tick(struct thread *cur) {
+    struct runqueue *rq = this_rq();
+    enum intr_level old_level;
+    int64_t now = timer_ticks();
+
+    if (cur->edf_period != 0) {
+        bool was_runnable = edf_runnable(cur);
+
+        if (was_runnable && --cur->edf_budget == 0) {
+            list_insert_ordered(&edf_demoted, &cur->edf_elem,
+                                edf_release_less, NULL);
+            intr_yield_on_return();
+        }
+        if (edf_refresh(cur, now) && !was_runnable)
+            intr_yield_on_return();
+    }
+    edf_rerelease(now);
+
+    old_level = spinlock_acquire(&rq->lock);
+    if (!list_empty(&rq->edf_queue)) {
+        struct thread *first = list_entry(list_front(&rq->edf_queue),
+                                          struct thread, elem);
+        if (!edf_runnable(cur) || first->edf_deadline < cur->edf_deadline)
+            intr_yield_on_return();
+    }
+    spinlock_release(&rq->lock, old_level);
+}
+
+/*! Orders EDF threads by deadline. */
+static bool edf_less(const struct list_elem *a, const struct list_elem *b,
+                     void *aux UNUSED) {
+    return list_entry(a, struct thread, elem)->edf_deadline
+           < list_entry(b, struct thread, elem)->edf_deadline;
+}
+
+/*! Orders demoted EDF threads by the release of their next job. */
+static bool edf_release_less(const struct list_elem *a_,
+                             const struct list_elem *b_, void *aux UNUSED) {
+    const struct thread *a = list_entry(a_, struct thread, edf_elem);
+    const struct thread *b = list_entry(b_, struct thread, edf_elem);
+
+    return a->edf_release + a->edf_period < b->edf_release + b->edf_period;
 }
 
 /*! Completes a thread switch by activating the new thread's page tables, and,
@@ -500,11 +1373,21 @@ static struct thread * next_thread_to_run(void) {
    After this function and its caller returns, the thread switch is complete. */
 void thread_schedule_tail(struct thread *prev) {
     struct thread *cur = running_thread();
-  
+    uint64_t now;
+
     ASSERT(intr_get_level() == INTR_OFF);
 
-    /* Mark us as running. */
+    /* Mark us as running, ending our time in the run queue. */
     cur->status = THREAD_RUNNING;
+    now = tsc_read();
+    cur->ready_cycles += now - cur->state_since;
+    cur->state_since = now;
+    if (cur->woken_at != 0)
+        trace_wakeup(cur, now);
+
+    /* Catch up on any decay that the sweep has not reached yet. */
+    if (thread_mlfqs && cur != idle_thread && cur->decay_epoch != decay_epoch)
+        mlfqs_refresh(cur);
 
     /* Start new time slice. */
     thread_ticks = 0;
@@ -521,7 +1404,15 @@ void thread_schedule_tail(struct thread *prev) {
     if (prev != NULL && prev->status == THREAD_DYING &&
         prev != initial_thread) {
         ASSERT(prev != cur);
-        palloc_free_page(prev);
+        exited_stats.threads++;
+        exited_stats.run_cycles += prev->run_cycles;
+        exited_stats.ready_cycles += prev->ready_cycles;
+        exited_stats.blocked_cycles += prev->blocked_cycles;
+        exited_stats.voluntary_switches += prev->voluntary_switches;
+        exited_stats.involuntary_switches += prev->involuntary_switches;
+        exited_stats.edf_jobs += prev->edf_jobs;
+        exited_stats.edf_misses += prev->edf_misses;
+        thread_page_put(prev);
     }
 }
 
@@ -535,16 +1426,134 @@ static void schedule(void) {
     struct thread *cur = running_thread();
     struct thread *next = next_thread_to_run();
     struct thread *prev = NULL;
+    uint64_t now;
 
     ASSERT(intr_get_level() == INTR_OFF);
     ASSERT(cur->status != THREAD_RUNNING);
     ASSERT(is_thread(next));
 
-    if (cur != next)
+    /* Charge the time slice that is ending.  A thread that is still
+       ready was preempted or yielded; any other gave up the CPU. */
+    now = tsc_read();
+    trace_switch(cur, next, now);
+    cur->run_cycles += now - cur->state_since;
+    cur->state_since = now;
+    if (cur != next) {
+        if (cur->status == THREAD_READY)
+            cur->involuntary_switches++;
+        else
+            cur->voluntary_switches++;
         prev = switch_threads(cur, next);
+    }
     thread_schedule_tail(prev);
 }
 
+/*! Records a switch from CUR, at time NOW, to NEXT: how much of its
+    time slice CUR used, and, if NEXT is a different thread, an entry in
+    the switch log.  Interrupts must be off. */
+static void trace_switch(struct thread *cur, struct thread *next,
+                         uint64_t now) {
+    struct switch_record *r;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (cur != idle_thread) {
+        uint64_t slice = tsc_hz() * TIME_SLICE / TIMER_FREQ;
+        uint64_t tenths = (now - cur->state_since) * 10 / slice;
+        slice_use[tenths < SLICE_BUCKETS ? tenths : SLICE_BUCKETS - 1]++;
+    }
+
+    if (cur == next)
+        return;
+    r = &switch_log[switch_cnt++ % SWITCH_LOG_SIZE];
+    r->when = now;
+    r->prev = cur->tid;
+    r->next = next->tid;
+    r->reason = (cur->status == THREAD_BLOCKED ? SWITCH_BLOCK
+                 : cur->status == THREAD_DYING ? SWITCH_EXIT
+                 : SWITCH_YIELD);
+}
+
+/*! Records the wakeup latency of CUR, which was unblocked and has just
+    started running at time NOW.  Interrupts must be off. */
+static void trace_wakeup(struct thread *cur, uint64_t now) {
+    uint64_t us = tsc_to_us(now - cur->woken_at);
+    int band = cur->ready_priority / LATENCY_BAND_SIZE;
+    int bucket = 0;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (us != 0 && bucket < LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    if (band >= LATENCY_BANDS)
+        band = LATENCY_BANDS - 1;
+    wakeup_latency[band][bucket]++;
+    cur->woken_at = 0;
+}
+
+/*! Prints the most recent thread switches, oldest first.  Safe to call
+    from a kernel panic. */
+void thread_print_switches(void) {
+    static struct switch_record log[SWITCH_LOG_SIZE];
+    static const char *reasons[] = { "block", "yield", "exit" };
+    enum intr_level old_level;
+    unsigned cnt, first, i;
+
+    /* Copy the log, since printing may switch threads. */
+    old_level = intr_disable();
+    cnt = switch_cnt < SWITCH_LOG_SIZE ? switch_cnt : SWITCH_LOG_SIZE;
+    first = switch_cnt - cnt;
+    for (i = 0; i < cnt; i++)
+        log[i] = switch_log[(first + i) % SWITCH_LOG_SIZE];
+    intr_set_level(old_level);
+
+    printf("Last %u of %u thread switches:\n", cnt, switch_cnt);
+    for (i = 0; i < cnt; i++)
+        printf("  %llu us: thread %d -> %d (%s)\n",
+               tsc_to_us(log[i].when), log[i].prev, log[i].next,
+               reasons[log[i].reason]);
+}
+
+/*! Returns a page for a new thread, recycled if possible, or a null
+    pointer if none is available.  The page is not zeroed. */
+static void *thread_page_get(void) {
+    enum intr_level old_level;
+    void *page = NULL;
+
+    old_level = intr_disable();
+    if (thread_page_cache_cnt > 0)
+        page = thread_page_cache[--thread_page_cache_cnt];
+    intr_set_level(old_level);
+
+    return page != NULL ? page : palloc_get_page(0);
+}
+
+/*! Disposes of the page of dying thread T, keeping it for reuse if the
+    cache has room.  Interrupts must be off. */
+static void thread_page_put(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* A stale pointer to T now fails is_thread(). */
+    t->magic = 0;
+    if (thread_page_cache_cnt < THREAD_PAGE_CACHE_SIZE)
+        thread_page_cache[thread_page_cache_cnt++] = t;
+    else
+        palloc_free_page(t);
+}
+
+/*! Gives every page in the thread page cache back to the page
+    allocator.  Does not sleep, so the page allocator may call it from
+    any context. */
+void thread_release_pages(void) {
+    enum intr_level old_level = intr_disable();
+
+    while (thread_page_cache_cnt > 0)
+        palloc_free_page(thread_page_cache[--thread_page_cache_cnt]);
+    intr_set_level(old_level);
+}
+
 /*! Returns a tid to use for a new thread. */
 static tid_t allocate_tid(void) {
     static tid_t next_tid = 1;
@@ -556,6 +1565,46 @@ static tid_t allocate_tid(void) {
 
     return tid;
 }
+
+/*! Enters thread T into the tid table with entry E, as a child of
+    PARENT, which may be NULL. */
+static void tid_insert(struct tid_entry *e, struct thread *t,
+                       struct thread *parent) {
+    enum intr_level old_level;
+
+    e->tid = t->tid;
+    e->thread = t;
+    e->parent = parent;
+    e->status = -1;
+    sema_init(&e->dead, 0);
+    t->tid_entry = e;
+
+    old_level = intr_disable();
+    list_push_back(&tid_table[e->tid % TID_BUCKETS], &e->elem);
+    if (parent != NULL)
+        list_push_back(&parent->children, &e->childelem);
+    intr_set_level(old_level);
+}
+
+/*! Returns the tid table entry for TID, or NULL if there is none.
+    Interrupts must be off. */
+static struct tid_entry *tid_find(tid_t tid) {
+    struct list *bucket;
+    struct list_elem *el;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (tid <= 0)
+        return NULL;
+    bucket = &tid_table[tid % TID_BUCKETS];
+    for (el = list_begin(bucket); el != list_end(bucket);
+         el = list_next(el)) {
+        struct tid_entry *e = list_entry(el, struct tid_entry, elem);
+        if (e->tid == tid)
+            return e;
+    }
+    return NULL;
+}
 
 /*! Offset of `stack' member within `struct thread'.
     Used by switch.S, which can't figure it out on its own. */
@@ -563,63 +1612,156 @@ uint32_t thread_stack_ofs = offsetof(struct thread, stack);
 
 
 
-/* TODO: Student added functions. */
+/*! Returns T's effective priority.  Under the BSD scheduler that is just
+    its computed priority; otherwise it includes priority donations. */
 int compute_priority(struct thread *t) { 
-    /* Advanced BSD scheduler. */
-    if (thread_mlfqs) { 
-        return t->priority;
-    }
-    /* Priority scheduler. */
-    else { 
-        int max_priority = t->priority;
-        struct list_elem *cur;
-        for (cur = list_begin(&t->lock_list); cur != list_end(&t->lock_list); 
-             cur = list_next(cur)) { 
-            struct lock *donor = list_entry(cur, struct lock, elem);
-            if (donor->donated_priority > max_priority) { 
-                max_priority = donor->donated_priority;
-            }
+    return thread_mlfqs ? t->priority : t->effective_priority;
+}
+
+/*! Recomputes T's effective priority from scratch, as the largest of its
+    own priority, the donations to the locks it holds, and the donation
+    from writers waiting for it to stop reading.  Only needed
+    when a donation may have gone away or the base priority changed;
+    lock_donate_priority() raises effective priorities directly. */
+void thread_recompute_priority(struct thread *t) {
+    int max_priority = t->priority;
+    struct list_elem *cur;
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    if (t->read_donation > max_priority)
+        max_priority = t->read_donation;
+    for (cur = list_begin(&t->lock_list); cur != list_end(&t->lock_list); 
+         cur = list_next(cur)) { 
+        struct lock *donor = list_entry(cur, struct lock, elem);
+        if (donor->donated_priority > max_priority) { 
+            max_priority = donor->donated_priority;
         }
-        return max_priority;
     }
+    t->effective_priority = max_priority;
+    thread_requeue(t);
+    intr_set_level(old_level);
+}
+
+/*! Updates the BSD scheduler for one timer tick, with CUR running.
+    Between the once-per-second recalculations only CUR's recent_cpu, and
+    therefore only its priority, can change, so nothing else is touched
+    on most ticks. */
+static void mlfqs_tick(struct thread *cur) {
+    int64_t ticks = timer_ticks();
 
+    if (cur != idle_thread)
+        cur->recent_cpu += FIXED_ONE;
+
+    if (ticks % TIMER_FREQ == 0) {
+        update_load_avg();
+        update_recent_cpus();
+    }
+    if (ticks % 4 == 0 && cur != idle_thread)
+        cur->priority = bsd_priority(cur);
+
+    if (ready_max_priority() > cur->priority)
+        intr_yield_on_return();
 }
 
-void update_bsd_priorities(void) {
-    if (thread_mlfqs) {
-        struct list_elem *cur;
-        for (cur = list_begin(&all_list); cur != list_end(&all_list); 
-             cur = list_next(cur)) { 
-            struct thread *t = list_entry(cur, struct thread, allelem);
-            fixed_F temp = fixed_div(t->recent_cpu, fixed_point(4));
-            t->priority = PRI_MAX - fixed_to_int(temp) - 2 * t->nice;
-        }
+/*! Brings T's recent_cpu up to date by replaying the decays it has
+    missed since its decay_epoch, then recomputes its priority.
+
+    The coefficients of decays older than the last DECAY_HISTORY are
+    gone, so those cannot be replayed.  With a decay coefficient C,
+    recent_cpu = C * recent_cpu + nice converges on its fixed point
+    nice / (1 - C), which is nice * (2 * load_avg + 1).  A thread that
+    missed more decays than the history holds therefore starts from the
+    fixed point for the oldest coefficient still known, rather than from
+    its stale recent_cpu, and the known decays are replayed from there.
+    How close this comes to the exact value depends on load_avg: the
+    stale value's weight after the skipped decays is C raised to their
+    number, which shrinks slowly when load_avg is high. */
+static void mlfqs_refresh(struct thread *t) {
+    int epoch = t->decay_epoch;
+
+    if (decay_epoch - epoch > DECAY_HISTORY) {
+        fixed_F oldest;
+
+        epoch = decay_epoch - DECAY_HISTORY;
+        oldest = decay_history[(epoch + 1) % DECAY_HISTORY];
+        t->recent_cpu = fixed_div(fixed_point(t->nice), FIXED_ONE - oldest);
+    }
+    while (epoch < decay_epoch) {
+        epoch++;
+        t->recent_cpu = fixed_mult(decay_history[epoch % DECAY_HISTORY],
+                                   t->recent_cpu) + fixed_point(t->nice);
     }
+    t->decay_epoch = decay_epoch;
+    t->priority = bsd_priority(t);
 }
 
-void update_recent_cpus(void) {
-    if (thread_mlfqs) {
-        struct list_elem *cur;
-        for (cur = list_begin(&all_list); cur != list_end(&all_list); 
-             cur = list_next(cur)) { 
-            struct thread *t = list_entry(cur, struct thread, allelem);
-            fixed_F temp = fixed_mult(fixed_point(2), load_avg);
-            temp = fixed_div(temp, temp + fixed_point(1));
-            temp = fixed_mult(temp, t->recent_cpu); 
-            t->recent_cpu = temp + fixed_point(t->nice);
+/*! Returns T's BSD scheduler priority, clamped to PRI_MIN..PRI_MAX. */
+static int bsd_priority(struct thread *t) {
+    int priority = PRI_MAX - fixed_to_int(fixed_div_int(t->recent_cpu, 4))
+                   - 2 * t->nice;
+    if (priority < PRI_MIN)
+        return PRI_MIN;
+    else if (priority > PRI_MAX)
+        return PRI_MAX;
+    return priority;
+}
+
+/*! Starts a new decay epoch and decays recent_cpu of the running
+    thread.  The ready threads, which may be many, are left to
+    mlfqs_sweep() in a worker thread, so that the timer interrupt does
+    not walk them with interrupts off.  Blocked threads catch up in
+    thread_unblock(). */
+static void update_recent_cpus(void) {
+    struct thread *cur = thread_current();
+    fixed_F twice_load = fixed_mult_int(load_avg, 2);
+
+    decay_epoch++;
+    decay_history[decay_epoch % DECAY_HISTORY] =
+        fixed_div(twice_load, twice_load + FIXED_ONE);
+
+    if (cur != idle_thread)
+        mlfqs_refresh(cur);
+    work_queue(&mlfqs_sweep_work);
+}
+
+/*! Brings every ready thread up to date with the current decay epoch
+    and moves it to its new run queue level.  Runs in a worker thread,
+    turning interrupts back on between levels. */
+static void mlfqs_sweep(void *aux UNUSED) {
+    struct runqueue *rq = this_rq();
+    int pri;
+
+    /* A thread whose priority changes moves to another level and may be
+       visited again, which is harmless: it is already up to date.  One
+       that moves to a level already swept is refreshed when it runs. */
+    for (pri = PRI_MIN; pri <= PRI_MAX; pri++) {
+        enum intr_level old_level = spinlock_acquire(&rq->lock);
+        struct list_elem *e = list_begin(&rq->queues[pri]);
+        while (e != list_end(&rq->queues[pri])) {
+            struct thread *t = list_entry(e, struct thread, elem);
+            e = list_next(e);
+            if (t != idle_thread && t->decay_epoch != decay_epoch) {
+                mlfqs_refresh(t);
+                if (t->ready_priority != t->priority) {
+                    ready_remove(t);
+                    ready_push(t);
+                }
+            }
         }
+        spinlock_release(&rq->lock, old_level);
     }
 }
 
-void update_load_avg(void) {
-    if (thread_mlfqs) {
-        int num_ready = list_size(&ready_list);
-        if (thread_current() != idle_thread) {
-            num_ready++;
-        }
-        load_avg = (fixed_mult(fixed_frac(59, 60), load_avg) + 
-                    fixed_mult(fixed_frac(1, 60), fixed_point(num_ready)));
+/*! Recomputes the load average from the number of ready threads plus
+    the running thread, if it is not idle. */
+static void update_load_avg(void) {
+    int num_ready = this_rq()->count;
+    if (thread_current() != idle_thread) {
+        num_ready++;
     }
+    load_avg = (fixed_mult(fixed_frac(59, 60), load_avg) + 
+                fixed_frac(num_ready, 60));
 }
 
 bool thread_is_top_priority(int priority) { 
@@ -9,6 +9,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <thread-stats.h>
 
 #include "threads/fixed-point.h"
 
@@ -30,6 +31,15 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /*!< Default priority. */
 #define PRI_MAX 63                      /*!< Highest priority. */
 
+/* Nice values for the BSD scheduler. */
+#define NICE_MIN -20                    /*!< Highest claim on the CPU. */
+#define NICE_MAX 20                     /*!< Lowest claim on the CPU. */
+
+/* Tickets for the stride scheduler. */
+#define TICKETS_MIN 1                   /*!< Smallest share of the CPU. */
+#define TICKETS_DEFAULT 100             /*!< Default share. */
+#define TICKETS_MAX 10000               /*!< Largest share of the CPU. */
+
 /*! A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -83,12 +93,10 @@ typedef int tid_t;
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion.
 
-   The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list.
+   The `elem' member is the thread's element in the run queue
+   (thread.c).  A blocked thread is instead linked into a wait queue
+   (synch.c) through a `struct waiter' on its own stack, which
+   `waiter' points to so that a priority donation can re-sort it.
 */
 struct thread {
     /*! Owned by thread.c. */
@@ -98,26 +106,53 @@ struct thread {
     char name[16];                      /*!< Name (for debugging purposes). */
     uint8_t *stack;                     /*!< Saved stack pointer. */
     int priority;                       /*!< Priority. */
+    int ready_priority;                 /*!< Run queue level while ready. */
     int nice;                           /*!< Niceness for BSD scheduler. */
     fixed_F recent_cpu;                 /*!< Needed for BSD scheduler. */
+    int decay_epoch;                    /*!< Last recent_cpu decay applied. */
+    int tickets;                        /*!< Share for stride scheduler. */
+    uint64_t stride;                    /*!< Pass added per tick run. */
+    uint64_t pass;                      /*!< Virtual time; lowest runs. */
+    struct thread *pass_left;           /*!< Run queue heap children, */
+    struct thread *pass_right;          /*!< under the stride scheduler. */
+    int pass_rank;                      /*!< Heap right spine length. */
+    int64_t edf_runtime;                /*!< EDF: ticks per period, or 0. */
+    int64_t edf_period;                 /*!< EDF: ticks between releases. */
+    int64_t edf_rel_deadline;           /*!< EDF: deadline after release. */
+    int64_t edf_release;                /*!< EDF: current job's release. */
+    int64_t edf_deadline;               /*!< EDF: current job's deadline. */
+    int64_t edf_budget;                 /*!< EDF: ticks left this period. */
+    bool edf_done;                      /*!< EDF: current job finished. */
+    unsigned edf_jobs;                  /*!< EDF: jobs released. */
+    unsigned edf_misses;                /*!< EDF: jobs that were late. */
+    struct list_elem edf_elem;          /*!< EDF: in list while demoted. */
+    uint64_t state_since;               /*!< TSC at last state change. */
+    uint64_t run_cycles;                /*!< Cycles spent running. */
+    uint64_t ready_cycles;              /*!< Cycles spent ready. */
+    uint64_t blocked_cycles;            /*!< Cycles spent blocked. */
+    unsigned voluntary_switches;        /*!< Switches away while blocking. */
+    unsigned involuntary_switches;      /*!< Switches away while ready. */
+    uint64_t woken_at;                  /*!< TSC when unblocked, or 0. */
     struct list_elem allelem;           /*!< List element for all threads list. */
+    struct tid_entry *tid_entry;        /*!< Entry in the tid table. */
+    struct list children;               /*!< Tid table entries of children. */
     /**@}*/
 
     /*! Shared between thread.c and synch.c. */
     /**@{*/
     struct list_elem elem;              /*!< List element. */
-    struct list lock_list; /*!< List of locks owned. */
+    struct list lock_list; /*!< Held locks that have waiters. */
     struct lock * lock_waiting;
+    struct waiter *waiter;     /*!< Wait queue entry while blocked. */
+    int effective_priority;    /*!< Priority including donations. */
+    struct rwlock *rwlock_draining; /*!< Rwlock whose readers it waits
+                                         for, as a writer. */
+    int read_holds;            /*!< Rwlocks held for reading. */
+    int read_donation;         /*!< Donated by writers waiting on them. */
     /**@}*/
 
     /**@}*/
 
-    /*! Shared between thread.c and devices/timer.c. */
-    /**@{*/
-    struct list_elem sleepelem; /*!< List element for sleep list. */
-    int wake_time;              /*!< Time to wake up. */
-    /**@}*/
-
 #ifdef USERPROG
     /*! Owned by userprog/process.c. */
     /**@{*/
@@ -136,11 +171,20 @@ struct thread {
     Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/*! If true, use the proportional-share stride scheduler, which ignores
+    priorities and gives each thread CPU time in proportion to its
+    tickets.  Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_idle_tick(void);
 void thread_print_stats(void);
+void thread_get_stats(struct thread *, struct thread_stats *);
+void thread_print_switches(void);
+void thread_release_pages(void);
 
 typedef void thread_func(void *aux);
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
@@ -154,8 +198,13 @@ const char *thread_name(void);
 
 void thread_exit(void) NO_RETURN;
 void thread_yield(void);
+void thread_yield_to_higher(void);
 void thread_sleep(void);
 
+int thread_wait(tid_t);
+void thread_set_exit_status(int);
+struct thread *thread_lookup(tid_t);
+
 /*! Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func(struct thread *t, void *aux);
 
@@ -169,15 +218,21 @@ void thread_set_nice(int);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
 
+int thread_get_tickets(void);
+void thread_set_tickets(int);
+
+bool thread_set_deadline(int64_t runtime, int64_t period, int64_t deadline);
+void thread_wait_period(void);
+unsigned thread_get_deadline_misses(void);
+
 /* Student added. */
 bool priority_less(const struct list_elem *a, 
                    const struct list_elem *b, void * aux);
 
 
 int compute_priority(struct thread *t);
-void update_bsd_priorities(void);
-void update_recent_cpus(void);
-void update_load_avg(void);
+void thread_recompute_priority(struct thread *t);
+void thread_requeue(struct thread *t);
 /* 
  * Checks if updated/new thread priority is the highest priority.
  * If it is, yields the current thread, so the updated thread
@@ -0,0 +1,110 @@
+/*! \file workqueue.c
+ *
+ * A pool of kernel worker threads that run work queued by interrupt
+ * handlers, with interrupts on.
+ *
+ * An external interrupt handler runs with interrupts off, so anything
+ * slow it does delays every other interrupt.  Such a handler can
+ * instead queue a struct work and return.  The workers run at PRI_MAX,
+ * so the work is done as soon as the handler returns, ahead of any
+ * other thread.
+ */
+
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/*! Number of worker threads.  More than one lets one piece of work
+    sleep without holding up the rest. */
+#define WORKER_CNT 2
+
+static struct list pending;             /*!< Queued work, oldest first. */
+static struct semaphore pending_cnt;    /*!< Up'd once per queued work. */
+
+static long long queued_cnt;            /*!< # of times work was queued. */
+static long long run_cnt;               /*!< # of work items run. */
+
+static thread_func worker;
+
+/*! Initializes the work queue.  Work may be queued from now on, but it
+    does not run until workqueue_start() is called. */
+void workqueue_init(void) {
+    list_init(&pending);
+    sema_init(&pending_cnt, 0);
+}
+
+/*! Starts the worker threads.  Must be called after thread_start(). */
+void workqueue_start(void) {
+    int i;
+
+    for (i = 0; i < WORKER_CNT; i++) {
+        char name[16];
+
+        snprintf(name, sizeof name, "worker %d", i);
+        thread_create(name, PRI_MAX, worker, NULL);
+    }
+}
+
+/*! Initializes W to call FUNC with AUX when it runs. */
+void work_init(struct work *w, work_func *func, void *aux) {
+    ASSERT(w != NULL);
+    ASSERT(func != NULL);
+
+    w->func = func;
+    w->aux = aux;
+    w->pending = false;
+}
+
+/*! Queues W to run in a worker thread.  Returns false, without doing
+    anything, if W is already queued and has not started running yet.
+
+    This function may be called from an interrupt handler. */
+bool work_queue(struct work *w) {
+    enum intr_level old_level;
+    bool queued = false;
+
+    ASSERT(w != NULL);
+
+    old_level = intr_disable();
+    if (!w->pending) {
+        w->pending = true;
+        list_push_back(&pending, &w->elem);
+        queued_cnt++;
+        queued = true;
+    }
+    intr_set_level(old_level);
+
+    if (queued)
+        sema_up(&pending_cnt);
+    return queued;
+}
+
+/*! Prints work queue statistics. */
+void workqueue_print_stats(void) {
+    printf("Workqueue: %lld queued, %lld run\n", queued_cnt, run_cnt);
+}
+
+/*! Worker thread.  Runs queued work forever. */
+static void worker(void *aux UNUSED) {
+    /* The BSD scheduler ignores the priority we were created with. */
+    if (thread_mlfqs)
+        thread_set_nice(NICE_MIN);
+
+    for (;;) {
+        enum intr_level old_level;
+        struct work *w;
+
+        sema_down(&pending_cnt);
+
+        old_level = intr_disable();
+        w = list_entry(list_pop_front(&pending), struct work, elem);
+        w->pending = false;
+        run_cnt++;
+        intr_set_level(old_level);
+
+        w->func(w->aux);
+    }
+}
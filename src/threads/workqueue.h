@@ -0,0 +1,33 @@
+/*! \file workqueue.h
+ *
+ * Deferred work, for interrupt handlers that have more to do than they
+ * should with interrupts off.
+ */
+
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/*! A function run by a worker thread. */
+typedef void work_func(void *aux);
+
+/*! A piece of deferred work.  The owner allocates it, typically
+    statically, and may queue it again once it has started running. */
+struct work {
+    struct list_elem elem;      /*!< Element in the pending list. */
+    work_func *func;            /*!< Function to call. */
+    void *aux;                  /*!< Argument to FUNC. */
+    bool pending;               /*!< True while queued but not yet run. */
+};
+
+void workqueue_init(void);
+void workqueue_start(void);
+
+void work_init(struct work *, work_func *, void *aux);
+bool work_queue(struct work *);
+
+void workqueue_print_stats(void);
+
+#endif /* threads/workqueue.h */
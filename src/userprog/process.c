@@ -75,12 +75,9 @@ static void start_process(void *file_name_) {
     terminated by the kernel (i.e. killed due to an exception), returns -1.
     If TID is invalid or if it was not a child of the calling process, or if
     process_wait() has already been successfully called for the given TID,
-    returns -1 immediately, without waiting.
-
-    This function will be implemented in problem 2-2.  For now, it does
-    nothing. */
-int process_wait(tid_t child_tid UNUSED) {
-    return -1;
+    returns -1 immediately, without waiting. */
+int process_wait(tid_t child_tid) {
+    return thread_wait(child_tid);
 }
 
 /*! Free the current process's resources. */
@@ -1,17 +1,75 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <thread-stats.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
 
 static void syscall_handler(struct intr_frame *);
+static bool user_range_ok(const void *, size_t);
+static bool sys_thread_stats(struct thread_stats *);
+static bool sys_set_tickets(int);
 
 void syscall_init(void) {
     intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
-static void syscall_handler(struct intr_frame *f UNUSED) {
+static void syscall_handler(struct intr_frame *f) {
+    uint32_t *args = f->esp;
+
+    if (user_range_ok(args, 2 * sizeof *args)) {
+        switch (args[0]) {
+        case SYS_THREAD_STATS:
+            f->eax = sys_thread_stats((struct thread_stats *) args[1]);
+            return;
+        case SYS_SET_TICKETS:
+            f->eax = sys_set_tickets((int) args[1]);
+            return;
+        }
+    }
+
     printf("system call!\n");
     thread_exit();
 }
 
+/*! Returns true if the SIZE bytes starting at user address UADDR are all
+    mapped in the current process's address space. */
+static bool user_range_ok(const void *uaddr, size_t size) {
+    uint32_t *pd = thread_current()->pagedir;
+    const uint8_t *start = uaddr;
+    const uint8_t *end = start + size;
+    const uint8_t *p;
+
+    if (size == 0)
+        return true;
+    if (end < start || !is_user_vaddr(end - 1))
+        return false;
+    for (p = pg_round_down(start); p < end; p += PGSIZE)
+        if (pagedir_get_page(pd, p) == NULL)
+            return false;
+    return true;
+}
+
+/*! Copies the running thread's CPU accounting to STATS in user memory.
+    Returns false if STATS is not a valid user buffer. */
+static bool sys_thread_stats(struct thread_stats *stats) {
+    struct thread_stats ks;
+
+    if (!user_range_ok(stats, sizeof *stats))
+        return false;
+    thread_get_stats(thread_current(), &ks);
+    memcpy(stats, &ks, sizeof ks);
+    return true;
+}
+
+/*! Sets the running thread's stride scheduler tickets.  Returns false
+    if TICKETS is out of range. */
+static bool sys_set_tickets(int tickets) {
+    if (tickets < TICKETS_MIN || tickets > TICKETS_MAX)
+        return false;
+    thread_set_tickets(tickets);
+    return true;
+}